@@ -1,9 +1,8 @@
+#include "IOcontroller.h"
 #include "framework.h"
 #include <fstream>
 #include <cassert>
 
-#include "IOcontroller.h"
-
 using namespace std;
 
 vector<vector<int>> IOcontroller::ReadMatrix(const string& f_name)
@@ -23,3 +22,92 @@ vector<vector<int>> IOcontroller::ReadMatrix(const string& f_name)
   }
   return adj_matrix;
 }
+
+Math::BitMatrix IOcontroller::ReadBitMatrix(const string& f_name)
+{
+  ifstream input(f_name, ios::binary);
+  if (!input) throw 0;
+  long long v_count = 0;
+  input >> v_count;
+  if (!input || v_count < 0 || v_count > UINT32_MAX / 2) throw 0;
+
+  Math::BitMatrix matrix(static_cast<u_int>(v_count));
+  const unsigned long long cells = static_cast<unsigned long long>(v_count) * v_count;
+  unsigned long long cell = 0;
+  vector<char> buffer(1 << 20);
+  //the byte after a digit is checked even if it's in the next chunk, the end of the file is a separator
+  bool digit = false;
+  while ((cell < cells || digit) && input) {
+    input.read(buffer.data(), buffer.size());
+    const size_t read = static_cast<size_t>(input.gcount());
+    for (size_t i = 0; i < read; ++i) {
+      const char c = buffer[i];
+      const bool space = c == ' ' || c == '\n' || c == '\r' || c == '\t';
+      //flags are single digits separated by white space
+      if (digit && !space) throw 0;
+      digit = false;
+      if (cell == cells) break;
+      if (c == '0' || c == '1') {
+        if (c == '1') matrix.Set(static_cast<u_int>(cell / v_count), static_cast<u_int>(cell % v_count));
+        cell++;
+        digit = true;
+      }
+      else if (!space) throw 0;
+    }
+  }
+  if (cell < cells) throw 0;
+  return matrix;
+}
+
+IOcontroller::EdgeStream::EdgeStream(const string& f_name)
+  : input(f_name, ios::binary), buffer(1 << 20)
+{
+  if (!input) throw 0;
+  unsigned long long v_count = 0;
+  if (!Number(v_count) || v_count > UINT32_MAX / 2) throw 0;
+  vertexes = static_cast<u_int>(v_count);
+}
+
+u_int IOcontroller::EdgeStream::Vertexes() const
+{
+  return vertexes;
+}
+
+bool IOcontroller::EdgeStream::Next(u_int& from, u_int& to)
+{
+  unsigned long long a = 0;
+  unsigned long long b = 0;
+  if (!Number(a)) return false;
+  //the edge without the second end is broken
+  if (!Number(b) || a >= vertexes || b >= vertexes) throw 0;
+  from = static_cast<u_int>(a);
+  to = static_cast<u_int>(b);
+  return true;
+}
+
+bool IOcontroller::EdgeStream::Number(unsigned long long& value)
+{
+  int c = Get();
+  while (c == ' ' || c == '\n' || c == '\r' || c == '\t') c = Get();
+  if (c == EOF) return false;
+  if (c < '0' || c > '9') throw 0;
+  value = 0;
+  for (; c >= '0' && c <= '9'; c = Get()) {
+    value = value * 10 + (c - '0');
+    if (value > UINT32_MAX) throw 0;
+  }
+  if (c != EOF && c != ' ' && c != '\n' && c != '\r' && c != '\t') throw 0;
+  return true;
+}
+
+int IOcontroller::EdgeStream::Get()
+{
+  if (position == size) {
+    if (!input) return EOF;
+    input.read(buffer.data(), buffer.size());
+    size = static_cast<size_t>(input.gcount());
+    position = 0;
+    if (size == 0) return EOF;
+  }
+  return static_cast<unsigned char>(buffer[position++]);
+}
@@ -1,8 +1,36 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <fstream>
+
+#include "bit_matrix.h"
 
 class IOcontroller {
 public:
   static std::vector<std::vector<int>> ReadMatrix(const std::string& f_name);
+  //the same format straight into bits, the file is read by big chunks
+  static Math::BitMatrix ReadBitMatrix(const std::string& f_name);
+
+  /* edge list read by big chunks without keeping it: the vertex count,
+  then pairs of vertex indexes separated by white space */
+  class EdgeStream {
+  public:
+    EdgeStream(const std::string& f_name);
+
+    u_int Vertexes() const;
+    //false at the end of the file, throws on broken input
+    bool Next(u_int& from, u_int& to);
+
+  private:
+    //false at the end of the file
+    bool Number(unsigned long long& value);
+    int Get();
+
+  private:
+    std::ifstream input;
+    std::vector<char> buffer;
+    size_t position = 0;
+    size_t size = 0;
+    u_int vertexes = 0;
+  };
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cstdio>
+
+#include "accounting.h"
+#include "doutput.h"
+
+using namespace std;
+
+namespace {
+
+  atomic<size_t> current[Memory::STAGES];
+  atomic<size_t> peak[Memory::STAGES];
+  atomic<size_t> total = 0;
+  atomic<size_t> total_peak = 0;
+  atomic<size_t> budget = 0;
+
+  void Raise(atomic<size_t>& p, size_t value)
+  {
+    size_t old = p.load(memory_order_relaxed);
+    while (old < value && !p.compare_exchange_weak(old, value, memory_order_relaxed)) {}
+  }
+
+}
+
+Memory::Usage Memory::GetUsage(Stage stage)
+{
+  const size_t s = static_cast<size_t>(stage);
+  return Usage{ .current = current[s].load(), .peak = peak[s].load() };
+}
+
+Memory::Usage Memory::GetTotal()
+{
+  return Usage{ .current = total.load(), .peak = total_peak.load() };
+}
+
+void Memory::ResetPeaks()
+{
+  for (size_t s = 0; s < STAGES; ++s) peak[s] = current[s].load();
+  total_peak = total.load();
+}
+
+void Memory::SetBudget(size_t bytes)
+{
+  budget = bytes;
+}
+
+size_t Memory::GetBudget()
+{
+  return budget;
+}
+
+void Memory::Acquire(Stage stage, size_t bytes)
+{
+  const size_t now = total.fetch_add(bytes, memory_order_relaxed) + bytes;
+  const size_t limit = budget.load(memory_order_relaxed);
+  if (limit != 0 && now > limit) {
+    total.fetch_sub(bytes, memory_order_relaxed);
+    throw BudgetExceeded(stage, bytes, limit);
+  }
+  Raise(total_peak, now);
+  const size_t s = static_cast<size_t>(stage);
+  Raise(peak[s], current[s].fetch_add(bytes, memory_order_relaxed) + bytes);
+}
+
+void Memory::Release(Stage stage, size_t bytes) noexcept
+{
+  current[static_cast<size_t>(stage)].fetch_sub(bytes, memory_order_relaxed);
+  total.fetch_sub(bytes, memory_order_relaxed);
+}
+
+void Memory::Report()
+{
+  for (size_t s = 0; s < STAGES; ++s) {
+    const Usage u = GetUsage(static_cast<Stage>(s));
+    DOUT(GetName(static_cast<Stage>(s)), "memory, bytes:", u.current, "peak", u.peak);
+  }
+  const Usage u = GetTotal();
+  DOUT("total memory, bytes:", u.current, "peak", u.peak, "budget", GetBudget());
+}
+
+const char* Memory::GetName(Stage stage)
+{
+  switch (stage) {
+  case Stage::GRAPH: return "graph";
+  case Stage::LAYOUT: return "layout";
+  case Stage::SCENE: return "scene";
+  }
+  throw 0;
+}
+
+Memory::BudgetExceeded::BudgetExceeded(Stage stage, size_t requested, size_t budget)
+  : stage(stage), requested(requested), budget(budget)
+{
+  snprintf(message, sizeof(message), "The %s stage needs %zu MB more, the memory budget of %zu MB is exceeded",
+    GetName(stage), (requested + (1 << 20) - 1) >> 20, budget >> 20);
+}
+
+const char* Memory::BudgetExceeded::what() const noexcept
+{
+  return message;
+}
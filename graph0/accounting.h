@@ -0,0 +1,100 @@
+#pragma once
+#include <new>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/* memory accounting of the pipeline stages: containers of the stage take the
+counting allocator, every stage keeps it's current and peak bytes. With the budget
+set, an allocation over it throws BudgetExceeded before the memory is taken */
+namespace Memory {
+
+  enum class Stage {
+    //bit matrix and CSR of the input graph
+    GRAPH,
+    //coordinates, distance tables and laid graphs
+    LAYOUT,
+    //retained scene of the painter
+    SCENE,
+  };
+  const size_t STAGES = 3;
+
+  struct Usage {
+    size_t current = 0;
+    size_t peak = 0;
+  };
+
+  Usage GetUsage(Stage stage);
+  //all the stages together
+  Usage GetTotal();
+  //peaks start again from the current bytes
+  void ResetPeaks();
+
+  //0 - no budget, the bytes of all the stages together
+  void SetBudget(size_t bytes);
+  size_t GetBudget();
+
+  //accounts the bytes, throws if the budget would be exceeded
+  void Acquire(Stage stage, size_t bytes);
+  void Release(Stage stage, size_t bytes) noexcept;
+
+  //current and peak bytes of every stage to the debug output
+  void Report();
+
+  const char* GetName(Stage stage);
+
+  class BudgetExceeded : public std::bad_alloc
+  {
+  public:
+    BudgetExceeded(Stage stage, size_t requested, size_t budget);
+
+    const char* what() const noexcept override;
+
+    Stage stage;
+    size_t requested;
+    size_t budget;
+
+  private:
+    char message[160];
+  };
+
+  template<typename T, Stage S>
+  struct Allocator {
+    using value_type = T;
+
+    //the stage is a non-type parameter, so rebinding is explicit
+    template<typename U>
+    struct rebind {
+      using other = Allocator<U, S>;
+    };
+
+    Allocator() noexcept = default;
+    template<typename U>
+    Allocator(const Allocator<U, S>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+      Acquire(S, n * sizeof(T));
+      try {
+        return std::allocator<T>().allocate(n);
+      }
+      catch (...) {
+        Release(S, n * sizeof(T));
+        throw;
+      }
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+      std::allocator<T>().deallocate(p, n);
+      Release(S, n * sizeof(T));
+    }
+
+    friend bool operator==(const Allocator&, const Allocator&) { return true; }
+    friend bool operator!=(const Allocator&, const Allocator&) { return false; }
+  };
+
+  template<typename T, Stage S>
+  using Vector = std::vector<T, Allocator<T, S>>;
+
+}
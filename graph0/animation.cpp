@@ -0,0 +1,91 @@
+#include <cmath>
+#include <unordered_map>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ANIMATION_SSE2
+#endif
+
+#include "animation.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  //out = round(a + t * d), 4 coordinates per instruction
+  void Lerp(const float* a, const float* d, float t, int* out, size_t n)
+  {
+    size_t i = 0;
+#ifdef ANIMATION_SSE2
+    const __m128 k = _mm_set1_ps(t);
+    for (; i + 4 <= n; i += 4) {
+      const __m128 p = _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(k, _mm_loadu_ps(d + i)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(p));
+    }
+#endif
+    //the same round to nearest even as cvtps
+    for (; i < n; ++i) out[i] = static_cast<int>(lrintf(a[i] + t * d[i]));
+  }
+
+}
+
+Paint::Transition::Transition(const Graph& from, const Graph& to, int duration_ms)
+  : begin(chrono::steady_clock::now()), duration(duration_ms)
+{
+  const auto& source = from.GetVertexes();
+  const auto& target = to.GetVertexes();
+  start.reserve(2 * target.size());
+  delta.reserve(2 * target.size());
+  current.resize(2 * target.size());
+
+  //the same order Graph::Render adds objects in
+  unordered_map<int, size_t> slots;
+  slots.reserve(target.size());
+  for (const auto& [id, v] : target) {
+    auto it = source.find(id);
+    const Point p = it == source.end() ? v.p : it->second.p;
+    slots[id] = slots.size();
+    start.push_back(static_cast<float>(p.x));
+    start.push_back(static_cast<float>(p.y));
+    delta.push_back(static_cast<float>(v.p.x - p.x));
+    delta.push_back(static_cast<float>(v.p.y - p.y));
+  }
+  ends.reserve(to.GetEdges().size());
+  for (const auto& e : to.GetEdges()) {
+    ends.emplace_back(slots.at(e.from), slots.at(e.to));
+  }
+}
+
+bool Paint::Transition::Step(Scene& scene)
+{
+  const auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - begin);
+  const float x = duration.count() > 0
+    ? min(1.f, elapsed.count() / static_cast<float>(duration.count())) : 1.f;
+  //smoothstep easing
+  Apply(scene, x * x * (3 - 2 * x));
+  return x < 1.f;
+}
+
+void Paint::Transition::Apply(Scene& scene, float t)
+{
+  const size_t n = current.size() / 2;
+  if (scene.GetEllipses().size() != n || scene.GetLines().size() != ends.size()) throw 0;
+
+  //chunks write disjoint slots of the unindexed scene, it's indexed again by the last frame
+  scene.SetIndexed(false);
+  Parallel::ForChunks(0, n, [&](size_t, size_t from, size_t to) {
+    Lerp(start.data() + 2 * from, delta.data() + 2 * from, t, current.data() + 2 * from, 2 * (to - from));
+    for (size_t v = from; v < to; ++v) {
+      const Point p{ current[2 * v], current[2 * v + 1] };
+      scene.SetEllipse(v, Ellipse{ .center = p });
+      scene.MoveLabel(v, p);
+    }
+    });
+  Parallel::For(0, ends.size(), [&](size_t e) {
+    const auto [a, b] = ends[e];
+    scene.SetLine(e, Line{
+      .from = Point{ current[2 * a], current[2 * a + 1] },
+      .to = Point{ current[2 * b], current[2 * b + 1] } });
+    });
+  if (t >= 1.f) scene.SetIndexed(true);
+}
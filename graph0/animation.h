@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <chrono>
+
+#include "graph.h"
+
+namespace Paint {
+
+  /* animated move of the drawn graph from one layout to another:
+  vertexes are matched by id, the new ones appear in place.
+  The scene must be rendered from the target graph */
+  class Transition
+  {
+  public:
+    Transition(const Graph& from, const Graph& to, int duration_ms = 600);
+
+    //puts the frame for the current time into the scene,
+    //returns false when the target layout is reached
+    bool Step(Scene& scene);
+    //t in [0; 1], no easing. The scene is unindexed until t reaches 1
+    void Apply(Scene& scene, float t);
+
+  private:
+    //x and y interleaved, in target graph vertex order
+    std::vector<float> start;
+    std::vector<float> delta;
+    std::vector<int> current;
+    //vertex slots of edge ends
+    std::vector<std::pair<size_t, size_t>> ends;
+
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::milliseconds duration;
+  };
+
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "bit_matrix.h"
+#include "components.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  //in place transpose of 64 x 64 bits, row i is a[i], column j is bit j:
+  //swaps off-diagonal 32 x 32 blocks, then 16 x 16 ones inside them and so on
+  void Transpose(uint64_t a[64])
+  {
+    uint64_t mask = 0x00000000FFFFFFFFull;
+    for (unsigned j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+      for (unsigned k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+        const uint64_t t = ((a[k] >> j) ^ a[k | j]) & mask;
+        a[k] ^= t << j;
+        a[k | j] ^= t;
+      }
+    }
+  }
+
+}
+
+Math::BitMatrix::BitMatrix(u_int size)
+  : size(size), stride((size + WORD - 1) / WORD), bits(size * stride, 0)
+{
+}
+
+u_int Math::BitMatrix::Size() const
+{
+  return size;
+}
+
+void Math::BitMatrix::Set(u_int row, u_int column, bool value)
+{
+  if (row >= size || column >= size) throw 0;
+  uint64_t& word = bits[row * stride + column / WORD];
+  const uint64_t bit = uint64_t(1) << (column % WORD);
+  word = value ? word | bit : word & ~bit;
+}
+
+bool Math::BitMatrix::Get(u_int row, u_int column) const
+{
+  if (row >= size || column >= size) throw 0;
+  return (bits[row * stride + column / WORD] >> (column % WORD)) & 1;
+}
+
+span<const uint64_t> Math::BitMatrix::Row(u_int row) const
+{
+  return span<const uint64_t>(bits.data() + row * stride, stride);
+}
+
+u_int Math::BitMatrix::Degree(u_int row) const
+{
+  u_int degree = 0;
+  for (uint64_t word : Row(row)) degree += popcount(word);
+  return degree;
+}
+
+bool Math::BitMatrix::IsSymmetric() const
+{
+  const size_t blocks = stride;
+  vector<char> symmetric(blocks, 1);
+  Parallel::For(0, blocks, [&](size_t I) {
+    uint64_t block[WORD];
+    //rows past the size are zero, as well as the padding columns
+    auto load = [&](size_t rows, size_t column, uint64_t* out) {
+      for (size_t r = 0; r < WORD; ++r) {
+        const size_t row = rows * WORD + r;
+        out[r] = row < size ? bits[row * stride + column] : 0;
+      }
+    };
+    for (size_t J = I; J < blocks && symmetric[I]; ++J) {
+      load(I, J, block);
+      Transpose(block);
+      for (size_t r = 0; r < WORD; ++r) {
+        const size_t row = J * WORD + r;
+        const uint64_t mirror = row < size ? bits[row * stride + I] : 0;
+        if (block[r] != mirror) {
+          symmetric[I] = 0;
+          break;
+        }
+      }
+    }
+    }, 1);
+  return all_of(symmetric.begin(), symmetric.end(), [](char s) { return s != 0; });
+}
+
+vector<vector<u_int>> Math::BitMatrix::ToAdjList() const
+{
+  vector<vector<u_int>> result(size);
+  Parallel::For(0, size, [&](size_t v) {
+    result[v].reserve(Degree(v));
+    ForEachInRow(v, [&](u_int n) { result[v].push_back(n); });
+    }, 1 << 10);
+  return result;
+}
+
+Math::CSR Math::BitMatrix::ToCSR() const
+{
+  CSR result;
+  result.offsets.resize(size + 1);
+  result.ids.resize(size);
+  Parallel::For(0, size, [&](size_t v) {
+    result.offsets[v] = Degree(v);
+    result.ids[v] = v;
+    }, 1 << 10);
+  result.offsets[size] = 0;
+  result.targets.resize(Parallel::PrefixSum(result.offsets));
+  Parallel::For(0, size, [&](size_t v) {
+    u_int* out = result.targets.data() + result.offsets[v];
+    ForEachInRow(v, [&out](u_int n) { *out++ = n; });
+    }, 1 << 10);
+  return result;
+}
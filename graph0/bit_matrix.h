@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <bit>
+#include <cstdint>
+
+#include "graph.h"
+
+namespace Math {
+
+  /* square 0/1 matrix packed by 64 cells in a word,
+  column c of a row is bit c % 64 of it's word c / 64 */
+  class BitMatrix
+  {
+  public:
+    BitMatrix(u_int size = 0);
+
+    u_int Size() const;
+    void Set(u_int row, u_int column, bool value = true);
+    bool Get(u_int row, u_int column) const;
+    std::span<const uint64_t> Row(u_int row) const;
+    //count of ones in the row
+    u_int Degree(u_int row) const;
+
+    //calls proc(column) for every one of the row in ascending order
+    template<typename Proc>
+    void ForEachInRow(u_int row, Proc proc) const;
+
+    //64 x 64 blocks are transposed in registers and compared with their mirror
+    bool IsSymmetric() const;
+
+    vector<vector<u_int>> ToAdjList() const;
+    CSR ToCSR() const;
+
+    static constexpr u_int WORD = 64;
+
+  private:
+    u_int size;
+    //words in a row
+    size_t stride;
+    Memory::Vector<uint64_t, Memory::Stage::GRAPH> bits;
+  };
+
+  template<typename Proc>
+  void BitMatrix::ForEachInRow(u_int row, Proc proc) const
+  {
+    const uint64_t* words = bits.data() + row * stride;
+    for (size_t w = 0; w < stride; ++w) {
+      //lowest one bit is taken off until the word is empty
+      for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+        proc(static_cast<u_int>(w * WORD + std::countr_zero(word)));
+      }
+    }
+  }
+
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "blocks.h"
+
+using namespace std;
+
+Math::Blocks::Blocks(CSRView graph)
+  : cut_node(graph.size, NO_NODE)
+{
+  if (graph.size == 0) return;
+  if (graph.size == 1) {
+    blocks.push_back({ 0 });
+    return;
+  }
+
+  const u_int NONE = static_cast<u_int>(-1);
+  vector<u_int> disc(graph.size, NONE);
+  vector<u_int> low(graph.size);
+  //vertexes whose block is not closed yet
+  vector<u_int> open;
+
+  struct Frame {
+    u_int v;
+    u_int parent;
+    u_int next;
+  };
+  vector<Frame> stack;
+  u_int time = 0;
+  disc[0] = low[0] = time++;
+  open.push_back(0);
+  stack.push_back(Frame{ 0, NONE, 0 });
+
+  while (!stack.empty()) {
+    Frame& f = stack.back();
+    const auto ns = graph.Neighbours(f.v);
+    if (f.next < ns.size()) {
+      const u_int n = ns[f.next++];
+      if (n == f.parent) continue;
+      if (disc[n] == NONE) {
+        disc[n] = low[n] = time++;
+        open.push_back(n);
+        stack.push_back(Frame{ n, f.v, 0 });
+      }
+      else {
+        low[f.v] = min(low[f.v], disc[n]);
+      }
+      continue;
+    }
+
+    const Frame done = f;
+    stack.pop_back();
+    if (done.parent == NONE) continue;
+    low[done.parent] = min(low[done.parent], low[done.v]);
+    //parent separates the subtree of done.v: close the block
+    if (low[done.v] >= disc[done.parent]) {
+      vector<u_int> block;
+      u_int w;
+      do {
+        w = open.back();
+        open.pop_back();
+        block.push_back(w);
+      } while (w != done.v);
+      block.push_back(done.parent);
+      blocks.push_back(move(block));
+    }
+  }
+
+  //vertex of several blocks is an articulation point
+  vector<u_int> block_count(graph.size, 0);
+  for (const auto& block : blocks) {
+    for (u_int v : block) block_count[v]++;
+  }
+  for (u_int v = 0; v < graph.size; ++v) {
+    if (block_count[v] > 1) cut_node[v] = blocks.size() + cut_count++;
+  }
+}
+
+u_int Math::Blocks::Count() const
+{
+  return blocks.size();
+}
+
+const vector<u_int>& Math::Blocks::GetBlock(u_int b) const
+{
+  return blocks[b];
+}
+
+bool Math::Blocks::IsArticulation(u_int v) const
+{
+  return cut_node[v] != NO_NODE;
+}
+
+vector<vector<u_int>> Math::Blocks::BlockCutTree() const
+{
+  vector<vector<u_int>> tree(blocks.size() + cut_count);
+  for (u_int b = 0; b < blocks.size(); ++b) {
+    for (u_int v : blocks[b]) {
+      if (IsArticulation(v)) {
+        tree[b].push_back(cut_node[v]);
+        tree[cut_node[v]].push_back(b);
+      }
+    }
+  }
+  return tree;
+}
+
+u_int Math::Blocks::GetCutNode(u_int v) const
+{
+  return cut_node[v];
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+#include "components.h"
+
+namespace Math {
+
+  /* biconnected components (blocks) and articulation points
+  of a connected graph, found by iterative Hopcroft-Tarjan DFS */
+  class Blocks
+  {
+  public:
+    Blocks(CSRView graph);
+
+    u_int Count() const;
+    //local indexes of the block vertexes
+    const vector<u_int>& GetBlock(u_int b) const;
+    bool IsArticulation(u_int v) const;
+
+    //blocks are nodes [0; Count()), articulation points follow them
+    vector<vector<u_int>> BlockCutTree() const;
+    //node of the articulation point in the block-cut tree
+    u_int GetCutNode(u_int v) const;
+
+    static constexpr u_int NO_NODE = static_cast<u_int>(-1);
+
+  private:
+    vector<vector<u_int>> blocks;
+    vector<u_int> cut_node;
+    u_int cut_count = 0;
+  };
+
+}
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <string>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define COMPACT_SSE2
+#endif
+
+#include "compact_layout.h"
+#include "parallel.h"
+
+using namespace std;
+
+static_assert(sizeof(Paint::Point) == 2 * sizeof(int), "points are stored as x, y pairs");
+
+namespace {
+
+  const int QUANTA = 1 << 16;
+
+  uint64_t Zigzag(int64_t v)
+  {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+  }
+
+  int64_t Unzigzag(uint64_t v)
+  {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+  }
+
+  void PutVarint(string& out, uint64_t v)
+  {
+    for (; v >= 0x80; v >>= 7) out.push_back(static_cast<char>(v | 0x80));
+    out.push_back(static_cast<char>(v));
+  }
+
+  void PutFloat(string& out, float f)
+  {
+    char bytes[sizeof(f)];
+    memcpy(bytes, &f, sizeof(f));
+    out.append(bytes, sizeof(f));
+  }
+
+  //reads the encoded buffer, every read past the end throws
+  class Reader {
+  public:
+    Reader(const string& data)
+      : data(data)
+    {
+    }
+
+    uint64_t Varint()
+    {
+      uint64_t v = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        if (position == data.size()) throw 0;
+        const uint8_t byte = static_cast<uint8_t>(data[position++]);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return v;
+      }
+      throw 0;
+    }
+
+    float Float()
+    {
+      float f = 0;
+      if (data.size() - position < sizeof(f)) throw 0;
+      memcpy(&f, data.data() + position, sizeof(f));
+      position += sizeof(f);
+      return f;
+    }
+
+  private:
+    const string& data;
+    size_t position = 0;
+  };
+
+  //quanta are the distances from the box side divided by the scale
+  float Scale(int extent)
+  {
+    return extent < QUANTA ? 1.f : static_cast<float>(extent) / (QUANTA - 1);
+  }
+
+  uint16_t Quantize(int distance, float scale)
+  {
+    return static_cast<uint16_t>(min<long>(lrintf(distance / scale), QUANTA - 1));
+  }
+
+}
+
+Paint::CompactLayout::CompactLayout(const Graph& laid, Math::CSRView graph)
+  : CompactLayout(laid, Math::Components(graph))
+{
+}
+
+Paint::CompactLayout::CompactLayout(const Graph& laid, const Math::Components& components)
+{
+  const u_int count = components.Count();
+  boxes.resize(count);
+  u_int first = 0;
+  for (u_int c = 0; c < count; ++c) {
+    boxes[c].first = first;
+    first += components.Slice(c).size;
+  }
+  ids.resize(first);
+  xs.resize(first);
+  ys.resize(first);
+
+  const auto& vertexes = laid.GetVertexes();
+  Parallel::For(0, count, [&](size_t c) {
+    const Math::CSRView part = components.Slice(static_cast<u_int>(c));
+    Box& box = boxes[c];
+    int right = INT_MIN;
+    int top = INT_MIN;
+    box.x = INT_MAX;
+    box.y = INT_MAX;
+    for (u_int v = 0; v < part.size; ++v) {
+      const Point p = vertexes.at(static_cast<int>(part.ids[v])).p;
+      box.x = min(box.x, p.x);
+      box.y = min(box.y, p.y);
+      right = max(right, p.x);
+      top = max(top, p.y);
+    }
+    box.scale_x = Scale(right - box.x);
+    box.scale_y = Scale(top - box.y);
+    for (u_int v = 0; v < part.size; ++v) {
+      const int id = static_cast<int>(part.ids[v]);
+      const Point p = vertexes.at(id).p;
+      ids[box.first + v] = id;
+      xs[box.first + v] = Quantize(p.x - box.x, box.scale_x);
+      ys[box.first + v] = Quantize(p.y - box.y, box.scale_y);
+    }
+    }, 64);
+}
+
+size_t Paint::CompactLayout::Size() const
+{
+  return ids.size();
+}
+
+size_t Paint::CompactLayout::Count() const
+{
+  return boxes.size();
+}
+
+int Paint::CompactLayout::GetId(size_t i) const
+{
+  return ids.at(i);
+}
+
+void Paint::CompactLayout::Decode(size_t from, size_t to, Point* points) const
+{
+  if (from > to || to > Size()) throw 0;
+  if (from == to) return;
+  //the box of the first vertex
+  size_t b = upper_bound(boxes.begin(), boxes.end(), from,
+    [](size_t i, const Box& box) { return i < box.first; }) - boxes.begin() - 1;
+  Point* out = points - from;
+  for (size_t i = from; i < to; ++b) {
+    const Box& box = boxes[b];
+    const size_t end = min(to, b + 1 < boxes.size() ? boxes[b + 1].first : Size());
+#ifdef COMPACT_SSE2
+    const __m128 sx = _mm_set1_ps(box.scale_x);
+    const __m128 sy = _mm_set1_ps(box.scale_y);
+    const __m128i ox = _mm_set1_epi32(box.x);
+    const __m128i oy = _mm_set1_epi32(box.y);
+    const __m128i zero = _mm_setzero_si128();
+    auto widen = [&](__m128i q, __m128 s, __m128i o) {
+      return _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(q), s)), o);
+    };
+    for (; i + 8 <= end; i += 8) {
+      const __m128i qx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs.data() + i));
+      const __m128i qy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys.data() + i));
+      //the low and the high 4 quanta zero-extended to 32 bits
+      const __m128i x0 = widen(_mm_unpacklo_epi16(qx, zero), sx, ox);
+      const __m128i x1 = widen(_mm_unpackhi_epi16(qx, zero), sx, ox);
+      const __m128i y0 = widen(_mm_unpacklo_epi16(qy, zero), sy, oy);
+      const __m128i y1 = widen(_mm_unpackhi_epi16(qy, zero), sy, oy);
+      //interleaved into x, y pairs
+      __m128i* p = reinterpret_cast<__m128i*>(out + i);
+      _mm_storeu_si128(p, _mm_unpacklo_epi32(x0, y0));
+      _mm_storeu_si128(p + 1, _mm_unpackhi_epi32(x0, y0));
+      _mm_storeu_si128(p + 2, _mm_unpacklo_epi32(x1, y1));
+      _mm_storeu_si128(p + 3, _mm_unpackhi_epi32(x1, y1));
+    }
+#endif
+    //the same round to nearest even as cvtps
+    for (; i < end; ++i) {
+      out[i] = Point{
+        box.x + static_cast<int>(lrintf(xs[i] * box.scale_x)),
+        box.y + static_cast<int>(lrintf(ys[i] * box.scale_y))
+      };
+    }
+  }
+}
+
+bool Paint::CompactLayout::Matches(Math::CSRView graph) const
+{
+  if (graph.size != Size()) return false;
+  vector<int> own(ids.begin(), ids.end());
+  vector<int> other(graph.size);
+  for (u_int v = 0; v < graph.size; ++v) other[v] = static_cast<int>(graph.ids ? graph.ids[v] : v);
+  sort(own.begin(), own.end());
+  sort(other.begin(), other.end());
+  return own == other;
+}
+
+Paint::Graph Paint::CompactLayout::ToGraph(Math::CSRView graph) const
+{
+  if (graph.size != Size()) throw 0;
+  vector<Vertex> vertexes(Size());
+  vector<Point> points(Size());
+  Parallel::ForChunks(0, Size(), [&](size_t, size_t from, size_t to) {
+    Decode(from, to, points.data() + from);
+    for (size_t i = from; i < to; ++i) vertexes[i] = Vertex{ ids[i], points[i] };
+    });
+
+  auto id = [&graph](u_int v) { return static_cast<int>(graph.ids ? graph.ids[v] : v); };
+  Edges edges;
+  edges.reserve(graph.Arcs() / 2);
+  for (u_int v = 0; v < graph.size; ++v) {
+    for (u_int n : graph.Neighbours(v)) {
+      if (v < n) edges.push_back(Edge{ id(v), id(n) });
+    }
+  }
+  return Graph(vertexes, move(edges));
+}
+
+size_t Paint::CompactLayout::Bytes() const
+{
+  return boxes.capacity() * sizeof(Box) + ids.capacity() * sizeof(int)
+    + (xs.capacity() + ys.capacity()) * sizeof(uint16_t);
+}
+
+void Paint::CompactLayout::Write(ostream& out) const
+{
+  string data;
+  data.reserve(16 + boxes.size() * 16 + Size() * 4);
+  PutVarint(data, MAGIC);
+  PutVarint(data, Size());
+  PutVarint(data, Count());
+  for (size_t b = 0; b < boxes.size(); ++b) {
+    const Box& box = boxes[b];
+    const size_t end = b + 1 < boxes.size() ? boxes[b + 1].first : Size();
+    PutVarint(data, end - box.first);
+    PutVarint(data, Zigzag(box.x));
+    PutVarint(data, Zigzag(box.y));
+    PutFloat(data, box.scale_x);
+    PutFloat(data, box.scale_y);
+    //slices are in ascending id order, the deltas are small
+    int64_t id = 0;
+    int x = 0;
+    int y = 0;
+    for (size_t i = box.first; i < end; ++i) {
+      PutVarint(data, Zigzag(ids[i] - id));
+      PutVarint(data, Zigzag(xs[i] - x));
+      PutVarint(data, Zigzag(ys[i] - y));
+      id = ids[i];
+      x = xs[i];
+      y = ys[i];
+    }
+  }
+  out.write(data.data(), data.size());
+  if (!out) throw 0;
+}
+
+Paint::CompactLayout Paint::CompactLayout::Read(istream& in)
+{
+  const string data{ istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+  Reader reader(data);
+  if (reader.Varint() != MAGIC) throw 0;
+  const uint64_t size = reader.Varint();
+  const uint64_t count = reader.Varint();
+  //every vertex takes at least 3 bytes and every box 10
+  if (size > data.size() / 3 || count > data.size() / 10 || count > size) throw 0;
+
+  CompactLayout layout;
+  layout.boxes.resize(count);
+  layout.ids.resize(size);
+  layout.xs.resize(size);
+  layout.ys.resize(size);
+  uint64_t first = 0;
+  auto quantum = [&reader](int previous) {
+    const int64_t q = previous + Unzigzag(reader.Varint());
+    if (q < 0 || q >= QUANTA) throw 0;
+    return static_cast<uint16_t>(q);
+  };
+  for (Box& box : layout.boxes) {
+    const uint64_t vertexes = reader.Varint();
+    if (vertexes > size - first) throw 0;
+    box.first = static_cast<u_int>(first);
+    box.x = static_cast<int>(Unzigzag(reader.Varint()));
+    box.y = static_cast<int>(Unzigzag(reader.Varint()));
+    box.scale_x = reader.Float();
+    box.scale_y = reader.Float();
+    if (!(box.scale_x > 0) || !(box.scale_y > 0)) throw 0;
+    int64_t id = 0;
+    int x = 0;
+    int y = 0;
+    for (uint64_t i = first; i < first + vertexes; ++i) {
+      id += Unzigzag(reader.Varint());
+      if (id < 0 || id > INT_MAX) throw 0;
+      layout.ids[i] = static_cast<int>(id);
+      x = layout.xs[i] = quantum(x);
+      y = layout.ys[i] = quantum(y);
+    }
+    first += vertexes;
+  }
+  if (first != size) throw 0;
+  return layout;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include "graph.h"
+#include "components.h"
+
+namespace Paint {
+
+  /* positions of a laid graph in 16 bits per coordinate: every connectivity
+  component keeps the offset and scale of it's bounding box, the vertexes are
+  quantized inside of it, boxes narrower than 65536 notional units are exact.
+  Edges aren't kept, they come from the CSR the graph was laid from.
+  On disk the ids and quanta are zigzag varint deltas of the previous vertex */
+  class CompactLayout
+  {
+  public:
+    CompactLayout() = default;
+    //the graph must be laid from the CSR, vertexes go in the order of the component slices
+    CompactLayout(const Graph& laid, Math::CSRView graph);
+    //the components the graph was laid by
+    CompactLayout(const Graph& laid, const Math::Components& components);
+
+    size_t Size() const;
+    //count of the components
+    size_t Count() const;
+    int GetId(size_t i) const;
+    //points of the vertexes [from; to), 8 per SSE2 iteration
+    void Decode(size_t from, size_t to, Point* points) const;
+    //whether the vertexes are the vertexes of the graph
+    bool Matches(Math::CSRView graph) const;
+    //the laid graph again, with the edges of the CSR
+    Graph ToGraph(Math::CSRView graph) const;
+    //allocated memory
+    size_t Bytes() const;
+
+    void Write(std::ostream& out) const;
+    //throws if the stream is broken
+    static CompactLayout Read(std::istream& in);
+
+  private:
+    struct Box {
+      //first vertex of the component
+      u_int first = 0;
+      int x = 0;
+      int y = 0;
+      //notional units per quantum
+      float scale_x = 1;
+      float scale_y = 1;
+    };
+
+    static const uint32_t MAGIC = 0x796c6367;
+
+  private:
+    Memory::Vector<Box, Memory::Stage::LAYOUT> boxes;
+    Memory::Vector<int, Memory::Stage::LAYOUT> ids;
+    Memory::Vector<uint16_t, Memory::Stage::LAYOUT> xs;
+    Memory::Vector<uint16_t, Memory::Stage::LAYOUT> ys;
+  };
+
+}
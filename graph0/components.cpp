@@ -0,0 +1,218 @@
+#include <atomic>
+#include <memory>
+
+#include "components.h"
+#include "parallel.h"
+
+using namespace std;
+
+/* Math::CSRView */
+
+u_int Math::CSRView::Degree(u_int v) const
+{
+  return offsets[v + 1] - offsets[v];
+}
+
+span<const u_int> Math::CSRView::Neighbours(u_int v) const
+{
+  return span<const u_int>(targets + offsets[v], targets + offsets[v + 1]);
+}
+
+size_t Math::CSRView::Arcs() const
+{
+  return size == 0 ? 0 : offsets[size] - offsets[0];
+}
+
+vector<vector<u_int>> Math::CSRView::ToAdjList() const
+{
+  vector<vector<u_int>> adj(size);
+  Parallel::For(0, size, [&](size_t v) {
+    const auto ns = Neighbours(v);
+    adj[v].assign(ns.begin(), ns.end());
+    });
+  return adj;
+}
+
+/* Math::BasicCSR */
+
+template<Memory::Stage S>
+Math::BasicCSR<S> Math::BasicCSR<S>::FromAdjList(const vector<vector<u_int>>& adj_list)
+{
+  BasicCSR result;
+  const size_t n = adj_list.size();
+  result.offsets.resize(n + 1);
+  result.ids.resize(n);
+  Parallel::For(0, n, [&](size_t v) {
+    result.offsets[v] = adj_list[v].size();
+    result.ids[v] = v;
+    });
+  result.offsets[n] = 0;
+  result.targets.resize(Parallel::PrefixSum(result.offsets));
+  Parallel::For(0, n, [&](size_t v) {
+    copy(adj_list[v].begin(), adj_list[v].end(), result.targets.begin() + result.offsets[v]);
+    });
+  return result;
+}
+
+template<Memory::Stage S>
+Math::CSRView Math::BasicCSR<S>::View() const
+{
+  return CSRView{
+    .size = static_cast<u_int>(ids.size()),
+    .offsets = offsets.data(),
+    .targets = targets.data(),
+    .ids = ids.data()
+  };
+}
+
+template struct Math::BasicCSR<Memory::Stage::GRAPH>;
+template struct Math::BasicCSR<Memory::Stage::LAYOUT>;
+
+/* Math::Components */
+
+namespace {
+
+  //roots are linked from the larger index to the smaller one,
+  //so the root of every set is it's least vertex
+  class UnionFind {
+  public:
+    UnionFind(size_t n) : parent(new atomic<u_int>[n]) {
+      Parallel::For(0, n, [this](size_t v) {
+        parent[v].store(v, memory_order_relaxed);
+        });
+    }
+
+    u_int Find(u_int v) {
+      while (true) {
+        u_int p = parent[v].load(memory_order_relaxed);
+        if (p == v) return v;
+        const u_int gp = parent[p].load(memory_order_relaxed);
+        //path halving, losing the race here is harmless
+        if (p != gp) parent[v].compare_exchange_weak(p, gp, memory_order_relaxed);
+        v = gp;
+      }
+    }
+
+    void Union(u_int u, u_int v) {
+      while (true) {
+        u = Find(u);
+        v = Find(v);
+        if (u == v) return;
+        if (u < v) swap(u, v);
+        u_int expected = u;
+        if (parent[u].compare_exchange_strong(expected, v, memory_order_relaxed)) return;
+      }
+    }
+
+  private:
+    unique_ptr<atomic<u_int>[]> parent;
+  };
+
+}
+
+Math::Components::Components(CSRView graph)
+  : comp(graph.size), local(graph.size)
+{
+  const size_t n = graph.size;
+  UnionFind uf(n);
+  Parallel::For(0, n, [&](size_t v) {
+    for (u_int u : graph.Neighbours(v)) {
+      if (v < u) uf.Union(v, u);
+    }
+    }, 1 << 12);
+
+  //roots get consecutive ids in ascending order
+  Memory::Vector<u_int, Memory::Stage::GRAPH> root(n);
+  Memory::Vector<u_int, Memory::Stage::GRAPH> is_root(n + 1, 0);
+  Parallel::For(0, n, [&](size_t v) {
+    root[v] = uf.Find(v);
+    is_root[v] = root[v] == v;
+    });
+  const u_int count = Parallel::PrefixSum(is_root);
+  Parallel::For(0, n, [&](size_t v) {
+    comp[v] = is_root[root[v]];
+    });
+
+  //component starts by prefix sum of their sizes
+  {
+    unique_ptr<atomic<u_int>[]> sizes(new atomic<u_int>[count]);
+    Parallel::For(0, count, [&](size_t c) { sizes[c].store(0, memory_order_relaxed); });
+    Parallel::For(0, n, [&](size_t v) { sizes[comp[v]].fetch_add(1, memory_order_relaxed); });
+    starts.resize(count + 1);
+    Parallel::For(0, count, [&](size_t c) { starts[c] = sizes[c].load(memory_order_relaxed); });
+    starts[count] = 0;
+    Parallel::PrefixSum(starts);
+  }
+
+  //stable counting sort of vertexes by component,
+  //it's parallel only when per chunk histograms are cheap
+  Memory::Vector<u_int, Memory::Stage::GRAPH> order(n);
+  const size_t chunks = Parallel::Threads();
+  if (chunks > 1 && static_cast<size_t>(count) * chunks <= n && n >= (1 << 16)) {
+    vector<vector<u_int>> fill(chunks, vector<u_int>(count, 0));
+    auto bounds = [n, chunks](size_t c) { return n * c / chunks; };
+    Parallel::For(0, chunks, [&](size_t c) {
+      for (size_t v = bounds(c); v < bounds(c + 1); ++v) fill[c][comp[v]]++;
+      }, 1);
+    Parallel::For(0, count, [&](size_t cc) {
+      u_int s = 0;
+      for (size_t c = 0; c < chunks; ++c) {
+        const u_int x = fill[c][cc];
+        fill[c][cc] = s;
+        s += x;
+      }
+      }, 1 << 10);
+    Parallel::For(0, chunks, [&](size_t c) {
+      for (size_t v = bounds(c); v < bounds(c + 1); ++v) {
+        local[v] = fill[c][comp[v]]++;
+        order[starts[comp[v]] + local[v]] = v;
+      }
+      }, 1);
+  }
+  else {
+    vector<u_int> fill(count, 0);
+    for (u_int v = 0; v < n; ++v) {
+      local[v] = fill[comp[v]]++;
+      order[starts[comp[v]] + local[v]] = v;
+    }
+  }
+
+  //CSR in the new order with local targets
+  csr.offsets.resize(n + 1);
+  csr.ids.resize(n);
+  Parallel::For(0, n, [&](size_t i) {
+    csr.offsets[i] = graph.Degree(order[i]);
+    csr.ids[i] = graph.ids ? graph.ids[order[i]] : order[i];
+    });
+  csr.offsets[n] = 0;
+  csr.targets.resize(Parallel::PrefixSum(csr.offsets));
+  Parallel::For(0, n, [&](size_t i) {
+    u_int* out = csr.targets.data() + csr.offsets[i];
+    for (u_int u : graph.Neighbours(order[i])) *out++ = local[u];
+    });
+}
+
+u_int Math::Components::Count() const
+{
+  return starts.empty() ? 0 : starts.size() - 1;
+}
+
+Math::CSRView Math::Components::Slice(u_int c) const
+{
+  return CSRView{
+    .size = starts[c + 1] - starts[c],
+    .offsets = csr.offsets.data() + starts[c],
+    .targets = csr.targets.data(),
+    .ids = csr.ids.data() + starts[c]
+  };
+}
+
+u_int Math::Components::GetComponent(u_int v) const
+{
+  return comp[v];
+}
+
+u_int Math::Components::GetLocal(u_int v) const
+{
+  return local[v];
+}
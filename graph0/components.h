@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <span>
+
+#include "graph.h"
+#include "accounting.h"
+
+namespace Math {
+
+  /* adjacency in compressed sparse row form,
+  view doesn't own the arrays, so slices of one big CSR
+  are passed around without copying */
+  struct CSRView {
+    u_int size = 0;
+    //size + 1 entries, neighbours of v are targets[offsets[v]; offsets[v + 1])
+    const u_int* offsets = nullptr;
+    //local indexes of neighbours
+    const u_int* targets = nullptr;
+    //local index -> vertex id
+    const u_int* ids = nullptr;
+
+    u_int Degree(u_int v) const;
+    std::span<const u_int> Neighbours(u_int v) const;
+    //every undirected edge is counted twice
+    size_t Arcs() const;
+    vector<vector<u_int>> ToAdjList() const;
+  };
+
+  //arrays of the CSR accounted to the stage
+  template<Memory::Stage S>
+  struct BasicCSR {
+    Memory::Vector<u_int, S> offsets;
+    Memory::Vector<u_int, S> targets;
+    Memory::Vector<u_int, S> ids;
+
+    static BasicCSR FromAdjList(const vector<vector<u_int>>& adj_list);
+    CSRView View() const;
+  };
+  //the input graph
+  using CSR = BasicCSR<Memory::Stage::GRAPH>;
+  //parts of the graph made while it's laid: blocks, trees, edited components
+  using LayoutCSR = BasicCSR<Memory::Stage::LAYOUT>;
+
+  /* connectivity components labelling:
+  lock-free union-find over the edges, then parallel prefix sums
+  give component ids, local indexes and CSR of every component */
+  class Components
+  {
+  public:
+    Components(CSRView graph);
+
+    u_int Count() const;
+    //vertexes of c-th component in ascending id order, targets are local
+    CSRView Slice(u_int c) const;
+
+    u_int GetComponent(u_int v) const;
+    u_int GetLocal(u_int v) const;
+
+  private:
+    //component of every vertex, components are numbered by their least vertex
+    Memory::Vector<u_int, Memory::Stage::GRAPH> comp;
+    //index of every vertex inside of it's component
+    Memory::Vector<u_int, Memory::Stage::GRAPH> local;
+    //first vertex of every component in CSR below, count + 1 entries
+    Memory::Vector<u_int, Memory::Stage::GRAPH> starts;
+    CSR csr;
+  };
+
+}
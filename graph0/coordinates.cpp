@@ -0,0 +1,30 @@
+#include <algorithm>
+
+#include "coordinates.h"
+
+using namespace std;
+
+Paint::Graph Math::ToPaintGraph(CSRView graph, const Coordinates& c)
+{
+  vector<Paint::Vertex> vertexes;
+  Paint::Edges edges;
+  if (graph.size == 0) return Paint::Graph(vertexes, move(edges));
+
+  const auto [minX, maxX] = minmax_element(c.x.begin(), c.x.end());
+  const auto [minY, maxY] = minmax_element(c.y.begin(), c.y.end());
+  const double extent = max(max(*maxX - *minX, *maxY - *minY), 1e-9);
+  const double scale = Paint::Graph::AREA_SIZE / extent;
+
+  vertexes.reserve(graph.size);
+  edges.reserve(graph.Arcs() / 2);
+  for (u_int v = 0; v < graph.size; ++v) {
+    vertexes.emplace_back(graph.ids[v], Paint::Point{
+      static_cast<int>((c.x[v] - *minX) * scale),
+      static_cast<int>((c.y[v] - *minY) * scale)
+      });
+    for (u_int n : graph.Neighbours(v)) {
+      if (v < n) edges.emplace_back(graph.ids[v], graph.ids[n]);
+    }
+  }
+  return Paint::Graph(vertexes, move(edges));
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <vector>
+
+#include "components.h"
+
+namespace Math {
+
+  //real coordinates of vertexes by their local indexes
+  struct Coordinates {
+    Memory::Vector<double, Memory::Stage::LAYOUT> x;
+    Memory::Vector<double, Memory::Stage::LAYOUT> y;
+  };
+
+  //fits the coordinates into the notional area keeping their proportions
+  Paint::Graph ToPaintGraph(CSRView graph, const Coordinates& c);
+
+}
@@ -0,0 +1,426 @@
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+#include "dynamic_graph.h"
+#include "components.h"
+
+using namespace std;
+
+Math::DynamicGraph::DynamicGraph()
+{
+}
+
+Math::DynamicGraph::DynamicGraph(vector<vector<u_int>> adj, Strategy strategy, TreeStrategy tree_strategy)
+  : strategy(strategy),
+    tree_strategy(tree_strategy),
+    adj_list(move(adj)),
+    alive(adj_list.size(), true),
+    comp(adj_list.size(), NO_COMPONENT),
+    pos(adj_list.size()),
+    local(adj_list.size())
+{
+  //BFS to get initial connectivity components
+  for (u_int v = 0; v < adj_list.size(); ++v) {
+    if (comp[v] != NO_COMPONENT) continue;
+    const u_int c = NewComponent();
+    queue<u_int> q;
+    q.push(v);
+    comp[v] = c;
+    while (!q.empty()) {
+      const u_int u = q.front();
+      q.pop();
+      pos[u] = members[c].size();
+      members[c].push_back(u);
+      for (u_int n : adj_list[u]) {
+        if (comp[n] == NO_COMPONENT) {
+          comp[n] = c;
+          q.push(n);
+        }
+      }
+    }
+    MarkDirty(c);
+  }
+}
+
+Math::DynamicGraph::DynamicGraph(vector<vector<u_int>> adj, const Paint::Graph& laid,
+  Strategy strategy, TreeStrategy tree_strategy)
+  : DynamicGraph(move(adj), strategy, tree_strategy)
+{
+  Seed(laid);
+}
+
+u_int Math::DynamicGraph::AddVertex()
+{
+  const u_int v = adj_list.size();
+  adj_list.emplace_back();
+  alive.push_back(true);
+  local.push_back(0);
+
+  const u_int c = NewComponent();
+  comp.push_back(c);
+  pos.push_back(0);
+  members[c].push_back(v);
+  MarkDirty(c);
+  return v;
+}
+
+void Math::DynamicGraph::RemoveVertex(u_int v)
+{
+  if (v >= adj_list.size() || !alive[v]) throw 0;
+  while (!adj_list[v].empty()) {
+    RemoveEdge(v, adj_list[v].back());
+  }
+  //now vertex is isolated, so it's component is dropped entirely
+  const u_int c = comp[v];
+  members[c].clear();
+  free_comps.push_back(c);
+  Release(c);
+  dirty.erase(c);
+
+  comp[v] = NO_COMPONENT;
+  alive[v] = false;
+}
+
+void Math::DynamicGraph::AddEdge(u_int u, u_int v)
+{
+  if (u >= adj_list.size() || v >= adj_list.size()) throw 0;
+  if (u == v || !alive[u] || !alive[v] || HasEdge(u, v)) throw 0;
+  adj_list[u].push_back(v);
+  adj_list[v].push_back(u);
+
+  if (comp[u] != comp[v]) {
+    Merge(comp[u], comp[v]);
+  }
+  else {
+    MarkDirty(comp[u]);
+  }
+}
+
+void Math::DynamicGraph::RemoveEdge(u_int u, u_int v)
+{
+  if (!HasEdge(u, v)) throw 0;
+  auto& un = adj_list[u];
+  auto& vn = adj_list[v];
+  un.erase(find(un.begin(), un.end(), v));
+  vn.erase(find(vn.begin(), vn.end(), u));
+
+  const vector<u_int> part = SmallerSide(u, v);
+  if (!part.empty()) {
+    Split(comp[u], part);
+  }
+  else {
+    MarkDirty(comp[u]);
+  }
+}
+
+bool Math::DynamicGraph::HasEdge(u_int u, u_int v) const
+{
+  if (u >= adj_list.size() || v >= adj_list.size()) return false;
+  const auto& shorter = adj_list[u].size() < adj_list[v].size() ? adj_list[u] : adj_list[v];
+  const u_int other = adj_list[u].size() < adj_list[v].size() ? v : u;
+  return find(shorter.begin(), shorter.end(), other) != shorter.end();
+}
+
+u_int Math::DynamicGraph::GetComponent(u_int v) const
+{
+  return v < comp.size() ? comp[v] : NO_COMPONENT;
+}
+
+const Paint::Graph& Math::DynamicGraph::Lay()
+{
+  //bigger components are placed first, they pack tighter
+  vector<u_int> order(dirty.begin(), dirty.end());
+  sort(order.begin(), order.end(), [this](u_int c1, u_int c2) {
+    return members[c1].size() > members[c2].size() || (members[c1].size() == members[c2].size() && c1 < c2);
+    });
+  for (u_int c : order) {
+    if (members[c].empty()) continue;
+    vector<u_int> ids = members[c];
+    sort(ids.begin(), ids.end());
+    for (u_int i = 0; i < ids.size(); ++i) {
+      local[ids[i]] = i;
+    }
+    //CSR of the component is laid as a slice
+    LayoutCSR csr;
+    csr.offsets.reserve(ids.size() + 1);
+    for (u_int v : ids) {
+      csr.offsets.push_back(static_cast<u_int>(csr.targets.size()));
+      for (u_int n : adj_list[v]) csr.targets.push_back(local[n]);
+    }
+    csr.offsets.push_back(static_cast<u_int>(csr.targets.size()));
+    csr.ids.assign(ids.begin(), ids.end());
+    Place(c, Math::Graph::LayComponent(csr.View(), strategy, tree_strategy));
+  }
+  dirty.clear();
+  return packed;
+}
+
+void Math::DynamicGraph::MoveVertex(u_int v, Paint::Point p)
+{
+  if (v >= adj_list.size() || !alive[v]) throw 0;
+  //the vertex of a dirty component isn't placed yet
+  if (packed.GetVertexes().count(static_cast<int>(v))) packed.MoveVertex(static_cast<int>(v), p);
+}
+
+vector<Paint::GraphEdit> Math::DynamicGraph::TakeEdits()
+{
+  return exchange(edits, {});
+}
+
+u_int Math::DynamicGraph::NewComponent()
+{
+  if (!free_comps.empty()) {
+    const u_int c = free_comps.back();
+    free_comps.pop_back();
+    return c;
+  }
+  members.emplace_back();
+  placements.emplace_back();
+  return members.size() - 1;
+}
+
+void Math::DynamicGraph::Merge(u_int c1, u_int c2)
+{
+  //relabel the smaller component only
+  if (members[c1].size() < members[c2].size()) swap(c1, c2);
+  for (u_int v : members[c2]) {
+    comp[v] = c1;
+    pos[v] = members[c1].size();
+    members[c1].push_back(v);
+  }
+  members[c2].clear();
+  free_comps.push_back(c2);
+  Release(c2);
+  dirty.erase(c2);
+  MarkDirty(c1);
+}
+
+void Math::DynamicGraph::Split(u_int c, const vector<u_int>& part)
+{
+  const u_int nc = NewComponent();
+  for (u_int v : part) {
+    //swap-remove from the old component
+    const u_int last = members[c].back();
+    members[c][pos[v]] = last;
+    pos[last] = pos[v];
+    members[c].pop_back();
+
+    comp[v] = nc;
+    pos[v] = members[nc].size();
+    members[nc].push_back(v);
+  }
+  MarkDirty(c);
+  MarkDirty(nc);
+}
+
+vector<u_int> Math::DynamicGraph::SmallerSide(u_int u, u_int v) const
+{
+  if (u == v) return {};
+  //0 - not seen, 1 - seen from u, 2 - seen from v
+  unordered_map<u_int, char> side;
+  vector<u_int> seen[2] = { { u }, { v } };
+  queue<u_int> q[2];
+  side[u] = 1;
+  side[v] = 2;
+  q[0].push(u);
+  q[1].push(v);
+
+  //expand both searches by one vertex in turn
+  for (int s = 0; ; s ^= 1) {
+    if (q[s].empty()) return seen[s];
+    const u_int x = q[s].front();
+    q[s].pop();
+    for (u_int n : adj_list[x]) {
+      const char n_side = side[n];
+      if (n_side == 2 - s) return {};
+      if (n_side == 0) {
+        side[n] = 1 + s;
+        seen[s].push_back(n);
+        q[s].push(n);
+      }
+    }
+  }
+}
+
+void Math::DynamicGraph::MarkDirty(u_int c)
+{
+  Unplace(c);
+  dirty.insert(c);
+}
+
+void Math::DynamicGraph::Seed(const Paint::Graph& laid)
+{
+  //the laid graph is shown already, so seeding isn't an edit
+  const auto& vertexes = laid.GetVertexes();
+  //the laid graph fills the notional area, the canvas side is the one the joined components get
+  canvas = sqrt(static_cast<double>(adj_list.size())) * (1 + PADDING);
+  const double rate = canvas / Paint::Graph::AREA_SIZE;
+  for (u_int c = 0; c < members.size(); ++c) {
+    const auto& ms = members[c];
+    if (ms.empty() || !all_of(ms.begin(), ms.end(), [&](u_int v) { return vertexes.count(static_cast<int>(v)); })) {
+      continue;
+    }
+    //the component stays where it is, it's slot is the square Place gives it around the center of it's box
+    int left = INT_MAX, top = INT_MAX, right = INT_MIN, bottom = INT_MIN;
+    Placement& placement = placements[c];
+    for (u_int v : ms) {
+      const Paint::Vertex& vertex = vertexes.at(static_cast<int>(v));
+      left = min(left, vertex.p.x);
+      top = min(top, vertex.p.y);
+      right = max(right, vertex.p.x);
+      bottom = max(bottom, vertex.p.y);
+      packed.AddVertex(vertex);
+      placement.vertexes.push_back(vertex.id);
+    }
+    const double side = min(canvas, sqrt(static_cast<double>(ms.size())) * (1 + PADDING));
+    placement.slot = Slot{
+      clamp((left + right) / 2. * rate - side / 2, 0., canvas - side),
+      clamp((top + bottom) / 2. * rate - side / 2, 0., canvas - side),
+      side,
+      true
+    };
+    //new shelves are put below the laid graph
+    shelves_height = max(shelves_height, bottom * rate);
+    dirty.erase(c);
+  }
+  for (const Paint::Edge& e : laid.GetEdges()) {
+    const u_int c = GetComponent(static_cast<u_int>(e.from));
+    if (c == NO_COMPONENT || dirty.count(c)) continue;
+    edge_owners.emplace_back(c, static_cast<u_int>(placements[c].edges.size()));
+    placements[c].edges.push_back(packed.AddEdge(e));
+  }
+}
+
+void Math::DynamicGraph::Place(u_int c, const Paint::Graph& laid)
+{
+  //the side grows as the square root of the vertexes, like the joined components do
+  const double side = sqrt(static_cast<double>(members[c].size())) * (1 + PADDING);
+  Placement& placement = placements[c];
+  //the component stays in it's slot while it fits there
+  if (!placement.slot || placement.slot->side < side) {
+    if (placement.slot && !placement.slot->seeded) free_slots.push_back(*placement.slot);
+    placement.slot = Allocate(side);
+  }
+  //canvas is the notional area
+  const Slot& slot = *placement.slot;
+  const double rate = Paint::Graph::AREA_SIZE / canvas;
+  const double inner = side / (1 + PADDING) / Paint::Graph::AREA_SIZE;
+  const double margin = side * PADDING / 2;
+  for (const auto& [id, v] : laid.GetVertexes()) {
+    AddPacked(Paint::Vertex{ id, Paint::Point{
+      static_cast<int>(lrint((slot.x + margin + v.p.x * inner) * rate)),
+      static_cast<int>(lrint((slot.y + margin + v.p.y * inner) * rate))
+    } });
+    placement.vertexes.push_back(id);
+  }
+  for (const Paint::Edge& e : laid.GetEdges()) {
+    edge_owners.emplace_back(c, static_cast<u_int>(placement.edges.size()));
+    placement.edges.push_back(AddPacked(e));
+  }
+}
+
+void Math::DynamicGraph::Unplace(u_int c)
+{
+  Placement& placement = placements[c];
+  for (int id : placement.vertexes) RemovePacked(id);
+  placement.vertexes.clear();
+  //the last packed edge takes the place of the removed one, so it's owner is told
+  //the new index, even if that's this component
+  for (size_t k = 0; k < placement.edges.size(); ++k) {
+    const size_t e = placement.edges[k];
+    const auto last = edge_owners.back();
+    placements[last.first].edges[last.second] = e;
+    edge_owners[e] = last;
+    edge_owners.pop_back();
+    RemovePacked(e);
+  }
+  placement.edges.clear();
+}
+
+void Math::DynamicGraph::Release(u_int c)
+{
+  Unplace(c);
+  if (placements[c].slot && !placements[c].slot->seeded) free_slots.push_back(*placements[c].slot);
+  placements[c].slot.reset();
+}
+
+Math::DynamicGraph::Slot Math::DynamicGraph::Allocate(double side)
+{
+  while (true) {
+    //the least free slot the component fits, not wasting more than it's own area
+    auto best = free_slots.end();
+    for (auto it = free_slots.begin(); it != free_slots.end(); ++it) {
+      if (it->side >= side && it->side <= 2 * side && (best == free_slots.end() || it->side < best->side)) {
+        best = it;
+      }
+    }
+    if (best != free_slots.end()) {
+      const Slot slot = *best;
+      *best = free_slots.back();
+      free_slots.pop_back();
+      return slot;
+    }
+    for (Shelf& shelf : shelves) {
+      if (shelf.height >= side && shelf.height <= 2 * side && shelf.used + side <= canvas) {
+        const Slot slot{ shelf.used, shelf.y, side };
+        shelf.used += side;
+        return slot;
+      }
+    }
+    if (shelves_height + side <= canvas) {
+      shelves.push_back(Shelf{ shelves_height, side, side });
+      shelves_height += side;
+      return Slot{ 0, shelves.back().y, side };
+    }
+    Grow(side);
+  }
+}
+
+void Math::DynamicGraph::Grow(double side)
+{
+  const double grown = max(2 * canvas, side);
+  //placed vertexes keep their canvas places
+  if (canvas > 0) {
+    const double rate = canvas / grown;
+    for (const auto& [id, v] : packed.GetVertexes()) {
+      MovePacked(id, Paint::Point{
+        static_cast<int>(lrint(v.p.x * rate)),
+        static_cast<int>(lrint(v.p.y * rate))
+      });
+    }
+  }
+  canvas = grown;
+}
+
+void Math::DynamicGraph::AddPacked(Paint::Vertex v)
+{
+  packed.AddVertex(v);
+  edits.push_back(Paint::GraphEdit{ .kind = Paint::GraphEdit::Kind::ADD_VERTEX, .vertex = v });
+}
+
+void Math::DynamicGraph::MovePacked(int id, Paint::Point p)
+{
+  packed.MoveVertex(id, p);
+  edits.push_back(Paint::GraphEdit{ .kind = Paint::GraphEdit::Kind::MOVE_VERTEX, .vertex = Paint::Vertex{ id, p } });
+}
+
+void Math::DynamicGraph::RemovePacked(int id)
+{
+  packed.RemoveVertex(id);
+  edits.push_back(Paint::GraphEdit{ .kind = Paint::GraphEdit::Kind::REMOVE_VERTEX, .vertex = Paint::Vertex{ id } });
+}
+
+size_t Math::DynamicGraph::AddPacked(Paint::Edge e)
+{
+  edits.push_back(Paint::GraphEdit{ .kind = Paint::GraphEdit::Kind::ADD_EDGE, .edge = e });
+  return packed.AddEdge(e);
+}
+
+void Math::DynamicGraph::RemovePacked(size_t edge)
+{
+  packed.RemoveEdge(edge);
+  edits.push_back(Paint::GraphEdit{ .kind = Paint::GraphEdit::Kind::REMOVE_EDGE, .index = edge });
+}
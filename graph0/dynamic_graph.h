@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <unordered_set>
+
+#include "graph.h"
+
+namespace Math {
+
+  /* graph for editing: keeps connectivity components up to date
+  after every insertion or deletion and keeps their packed layout,
+  so only the touched components are laid out and placed again.
+  Components are squares on a shelf-packed canvas, the clean ones never move */
+  class DynamicGraph
+  {
+  public:
+    DynamicGraph();
+    //components are laid with the strategies on the first Lay()
+    DynamicGraph(vector<vector<u_int>> adj_list,
+      Strategy strategy = Strategy::AUTO, TreeStrategy tree_strategy = TreeStrategy::RADIAL);
+    //components keep their places in the laid graph until they are edited,
+    //the edited ones are laid with the strategies
+    DynamicGraph(vector<vector<u_int>> adj_list, const Paint::Graph& laid,
+      Strategy strategy = Strategy::AUTO, TreeStrategy tree_strategy = TreeStrategy::RADIAL);
+
+    //returns id of the new isolated vertex
+    u_int AddVertex();
+    void RemoveVertex(u_int v);
+
+    void AddEdge(u_int u, u_int v);
+    void RemoveEdge(u_int u, u_int v);
+
+    bool HasEdge(u_int u, u_int v) const;
+    u_int GetComponent(u_int v) const;
+
+    static constexpr u_int NO_COMPONENT = static_cast<u_int>(-1);
+
+    //lays and places dirty components, the clean ones keep their places
+    const Paint::Graph& Lay();
+    //the vertex stays there until it's component is laid again,
+    //it's moved by the caller, so the move isn't an edit
+    void MoveVertex(u_int v, Paint::Point p);
+    //changes of the packed graph made by Lay() since the last call, in their order
+    vector<Paint::GraphEdit> TakeEdits();
+
+  private:
+    u_int NewComponent();
+    void Merge(u_int c1, u_int c2);
+    //moves vertexes that left the component to the new one
+    void Split(u_int c, const vector<u_int>& part);
+    //bidirectional search that stops when the smaller side is exhausted,
+    //returns that side or empty vector if u and v are still connected
+    vector<u_int> SmallerSide(u_int u, u_int v) const;
+    void MarkDirty(u_int c);
+    //places the components as they are in the laid graph
+    void Seed(const Paint::Graph& laid);
+
+    //square of the canvas
+    struct Slot {
+      double x = 0;
+      double y = 0;
+      double side = 0;
+      //around a seeded component, may overlap the neighbours and isn't reused
+      bool seeded = false;
+    };
+    //row of slots with the height of the first one
+    struct Shelf {
+      double y = 0;
+      double height = 0;
+      double used = 0;
+    };
+    //what the component put into the packed graph
+    struct Placement {
+      std::optional<Slot> slot;
+      vector<int> vertexes;
+      //indexes in the packed edges
+      vector<size_t> edges;
+    };
+
+    void Place(u_int c, const Paint::Graph& laid);
+    //takes vertexes and edges of the component out of the packed graph
+    void Unplace(u_int c);
+    //unplaces the component and frees it's slot
+    void Release(u_int c);
+    Slot Allocate(double side);
+    //the canvas side grows at least twice, packed graph shrinks to fit the notional area
+    void Grow(double side);
+    //changes of the packed graph, recorded for TakeEdits()
+    void AddPacked(Paint::Vertex v);
+    void MovePacked(int id, Paint::Point p);
+    void RemovePacked(int id);
+    size_t AddPacked(Paint::Edge e);
+    void RemovePacked(size_t edge);
+
+  private:
+    Strategy strategy = Strategy::AUTO;
+    TreeStrategy tree_strategy = TreeStrategy::RADIAL;
+    vector<vector<u_int>> adj_list;
+    vector<bool> alive;
+
+    //component of every vertex, members of every component
+    //and position of every vertex among them
+    vector<u_int> comp;
+    vector<vector<u_int>> members;
+    vector<u_int> pos;
+    vector<u_int> free_comps;
+
+    std::unordered_set<u_int> dirty;
+    //placed components in the notional area
+    Paint::Graph packed = Paint::Graph({}, {});
+    vector<Placement> placements;
+    //component and index in it's edges of every packed edge
+    vector<std::pair<u_int, u_int>> edge_owners;
+    vector<Paint::GraphEdit> edits;
+    vector<Slot> free_slots;
+    vector<Shelf> shelves;
+    double canvas = 0;
+    double shelves_height = 0;
+    //room around every component, part of it's side
+    static constexpr double PADDING = 0.2;
+    //vertex id -> index in it's component, reused between layings
+    vector<u_int> local;
+  };
+
+}
@@ -0,0 +1,117 @@
+#include "glyph_atlas.h"
+
+#include <cmath>
+
+using namespace std;
+
+Paint::GlyphAtlas::GlyphAtlas(const WCHAR* font, int size, Gdiplus::Color color)
+  : size(size)
+{
+  using namespace Gdiplus;
+  //the same font as the one of DrawString labels
+  const Font f(font, static_cast<REAL>(size));
+  const StringFormat* format = StringFormat::GenericTypographic();
+  {
+    Bitmap probe(1, 1, PixelFormat32bppARGB);
+    Graphics graphics(&probe);
+    RectF box;
+    graphics.MeasureString(L"0", 1, &f, PointF(0, 0), format, &box);
+    advance = box.Width;
+    line_height = f.GetHeight(&graphics);
+  }
+  margin = 2 + size / 4;
+  cellW = static_cast<int>(ceil(advance)) + 2 * margin;
+  cellH = static_cast<int>(ceil(line_height)) + 2 * margin;
+
+  //white glyphs on the transparent background, alpha is the coverage
+  Bitmap atlas(cellW * static_cast<int>(glyphs.size()), cellH, PixelFormat32bppARGB);
+  if (atlas.GetLastStatus() != Ok) throw 0;
+  {
+    Graphics graphics(&atlas);
+    graphics.SetTextRenderingHint(TextRenderingHintAntiAliasGridFit);
+    graphics.Clear(Color(0, 0, 0, 0));
+    const SolidBrush white(Color(255, 255, 255, 255));
+    for (size_t d = 0; d < glyphs.size(); ++d) {
+      const WCHAR c = static_cast<WCHAR>(L'0' + d);
+      graphics.DrawString(&c, 1, &f,
+        PointF(static_cast<REAL>(d * cellW + margin), static_cast<REAL>(margin)), format, &white);
+    }
+  }
+
+  const Rect all(0, 0, cellW * static_cast<int>(glyphs.size()), cellH);
+  BitmapData data;
+  if (atlas.LockBits(&all, ImageLockModeRead, PixelFormat32bppARGB, &data) != Ok) throw 0;
+  const unsigned alpha = color.GetA();
+  coverage.assign(glyphs.size() * cellW * cellH, 0);
+  for (size_t d = 0; d < glyphs.size(); ++d) {
+    Glyph& glyph = glyphs[d];
+    glyph = Glyph{ cellW, cellH, 0, 0 };
+    uint16_t* cell = coverage.data() + d * cellW * cellH;
+    for (int y = 0; y < cellH; ++y) {
+      const auto* row = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(data.Scan0) + static_cast<ptrdiff_t>(y) * data.Stride) + d * cellW;
+      for (int x = 0; x < cellW; ++x) {
+        //0..255 * 0..255 -> 0..256
+        const unsigned a = (row[x] >> 24) * alpha;
+        cell[y * cellW + x] = static_cast<uint16_t>((a * 256 + 65025 / 2) / 65025);
+        if (cell[y * cellW + x] == 0) continue;
+        glyph.left = min(glyph.left, x);
+        glyph.top = min(glyph.top, y);
+        glyph.right = max(glyph.right, x + 1);
+        glyph.bottom = max(glyph.bottom, y + 1);
+      }
+    }
+  }
+  atlas.UnlockBits(&data);
+
+  const uint32_t value = color.GetValue();
+  rb = value & 0xFF00FF;
+  g = value & 0xFF00;
+}
+
+int Paint::GlyphAtlas::Size() const
+{
+  return size;
+}
+
+bool Paint::GlyphAtlas::Covers(string_view text) const
+{
+  for (char c : text) {
+    if (c < '0' || c > '9') return false;
+  }
+  return true;
+}
+
+void Paint::GlyphAtlas::Draw(const Surface& surface, string_view text, int x, int y) const
+{
+  const float left = x - advance * text.size() / 2;
+  const int top = static_cast<int>(lrintf(y - line_height / 2)) - margin;
+  for (size_t k = 0; k < text.size(); ++k) {
+    const size_t d = text[k] - '0';
+    Blit(surface, glyphs[d], coverage.data() + d * cellW * cellH,
+      static_cast<int>(lrintf(left + advance * k)) - margin, top);
+  }
+}
+
+void Paint::GlyphAtlas::Blit(const Surface& surface, const Glyph& glyph, const uint16_t* cell, int x, int y) const
+{
+  const int x1 = max(x + glyph.left, max(static_cast<int>(surface.clip.left), 0));
+  const int y1 = max(y + glyph.top, max(static_cast<int>(surface.clip.top), 0));
+  const int x2 = min(x + glyph.right, min(static_cast<int>(surface.clip.right), surface.width));
+  const int y2 = min(y + glyph.bottom, min(static_cast<int>(surface.clip.bottom), surface.height));
+  for (int py = y1; py < y2; ++py) {
+    const uint16_t* src = cell + static_cast<ptrdiff_t>(py - y) * cellW - x;
+    uint32_t* dst = surface.pixels + py * surface.stride;
+    for (int px = x1; px < x2; ++px) {
+      const uint32_t a = src[px];
+      if (a == 0) continue;
+      const uint32_t inv = 256 - a;
+      const uint32_t d = dst[px];
+      const uint32_t da = d >> 24;
+      //two channels per multiplication, the sums stay below 2^32
+      dst[px] = (((rb * a + (d & 0xFF00FF) * inv) >> 8) & 0xFF00FF)
+        | (((g * a + (d & 0xFF00) * inv) >> 8) & 0xFF00)
+        | ((da + ((255 - da) * a >> 8)) << 24);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "windows.h"
+#include "gdiplus.h"
+
+#include <array>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace Paint {
+
+  //32-bit ARGB pixels of a DIB section or a locked bitmap
+  struct Surface {
+    uint32_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    //in pixels
+    ptrdiff_t stride = 0;
+    //nothing is written outside of it
+    RECT clip{};
+  };
+
+  /* digit glyphs rasterized once for one font size: labels made of digits
+  are composited from the atlas straight into the pixel memory, without
+  text shaping. Read-only after construction, shared between threads */
+  class GlyphAtlas
+  {
+  public:
+    GlyphAtlas(const WCHAR* font, int size, Gdiplus::Color color);
+
+    int Size() const;
+    //whether all characters of the text have glyphs
+    bool Covers(std::string_view text) const;
+    //text line centered at (x, y), the same place as the centered DrawString
+    void Draw(const Surface& surface, std::string_view text, int x, int y) const;
+
+  private:
+    struct Glyph {
+      //ink box in the cell
+      int left = 0;
+      int top = 0;
+      int right = 0;
+      int bottom = 0;
+    };
+
+    //blends ink of the glyph with the cell origin at (x, y)
+    void Blit(const Surface& surface, const Glyph& glyph, const uint16_t* cell, int x, int y) const;
+
+  private:
+    int size;
+    float advance = 0;
+    float line_height = 0;
+    //room around the line box for the ink overhang
+    int margin = 0;
+    int cellW = 0;
+    int cellH = 0;
+    //per glyph cellW * cellH coverage already multiplied by the color alpha, 0..256
+    std::vector<uint16_t> coverage;
+    std::array<Glyph, 10> glyphs;
+    //color channels, red and blue in one word for two-at-once blending
+    uint32_t rb = 0;
+    uint32_t g = 0;
+  };
+
+}
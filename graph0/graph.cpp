@@ -6,6 +6,13 @@
 #include <queue>
 
 #include "graph.h"
+#include "components.h"
+#include "blocks.h"
+#include "mds.h"
+#include "spectral.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "bit_matrix.h"
 
 using namespace std;
 
@@ -31,47 +38,23 @@ vector<vector<u_int>> Math::Graph::AdjListFromMatrix(const vector<vector<int>>&
   return result;
 }
 
-Paint::Graph Math::Graph::Lay() const
+vector<vector<u_int>> Math::Graph::AdjListFromMatrix(const BitMatrix& adj_matrix)
 {
-  vector<Paint::Graph> ccs;
-  //run DFS to get connectivity components (ccs)
-  vector<bool> visited(adj_list.size(), false);
-  for (u_int v = 0; v < adj_list.size(); ++v) {
-    if (!visited[v]) {
-      vector<u_int> ccv;
-      DFS(v, visited, [&ccv](u_int v) { ccv.push_back(v); });
-
-      //nextly create cc with converter
-      sort(ccv.begin(), ccv.end());
-      vector<vector<u_int>> adj(ccv.size());
-      for (u_int v = 0; v < adj.size(); ++v) {
-        for (u_int n : adj_list[ccv[v]]) {
-          adj[v].push_back(
-            distance(ccv.begin(), lower_bound(ccv.begin(), ccv.end(), n))
-          );
-        }
-      }
-      const size_t cc_vertexes = ccv.size();
-      Math::Graph g(move(adj));
-      g.ConvertOn(move(ccv));
-      if (g.HasCycle()) {
-        Math::ConnectedGraph cg = g.TurnIntoConGraph(true);
-        ccs.emplace_back(cg.Lay());
-      }
-      else {
-        Math::Tree t = g.TurnIntoTree(true);
-        ccs.emplace_back(t.Lay());
-      }
+  return adj_matrix.ToAdjList();
+}
 
-      //scale cc by vertex count
-      ccs.back().Scale(
-        sqrt(cc_vertexes / static_cast<double>(adj_list.size()))
-      );
-    }
-  }
+Paint::Graph Math::Graph::Lay() const
+{
+  //connectivity components are laid by the chosen strategy and joined
+  const CSR csr = CSR::FromAdjList(adj_list);
+  return DynamicPipeline(Policy::Dynamic{ .strategy = strategy, .tree_strategy = tree_strategy }).Lay(csr.View());
+}
 
-  //join connectivity components
-  return Paint::Graph::Join(move(ccs));
+Paint::Graph Math::Graph::LayComponent(CSRView part, Strategy strategy, TreeStrategy tree_strategy)
+{
+  //connected graph is a tree if it has one edge less than vertexes
+  if (part.Arcs() / 2 + 1 == part.size) return Tree::Lay(part, tree_strategy);
+  return ConnectedGraph::Lay(part, strategy);
 }
 
 template<typename Proc>
@@ -102,6 +85,16 @@ void Math::Graph::ConvertOff()
   convert = false;
 }
 
+void Math::Graph::SetStrategy(Strategy s)
+{
+  strategy = s;
+}
+
+void Math::Graph::SetTreeStrategy(TreeStrategy s)
+{
+  tree_strategy = s;
+}
+
 bool Math::Graph::HasCycle() const
 {
   vector<bool> visited(adj_list.size(), false);
@@ -139,6 +132,8 @@ Math::ConnectedGraph Math::Graph::TurnIntoConGraph(bool move)
     result.ConvertOn(converter);
     if (!convert) result.ConvertOff();
   }
+  result.SetStrategy(strategy);
+  result.SetTreeStrategy(tree_strategy);
   return result;
 }
 
@@ -155,6 +150,8 @@ Math::Tree Math::Graph::TurnIntoTree(bool move)
     result.ConvertOn(converter);
     if (!convert) result.ConvertOff();
   }
+  result.SetStrategy(strategy);
+  result.SetTreeStrategy(tree_strategy);
   return result;
 }
 
@@ -163,68 +160,211 @@ Math::Tree Math::Graph::TurnIntoTree(bool move)
 
 
 Paint::Graph Math::ConnectedGraph::Lay() const
+{
+  const CSR csr = ToCSR();
+  return Lay(csr.View(), strategy);
+}
+
+Paint::Graph Math::ConnectedGraph::Lay(CSRView graph, Strategy strategy)
+{
+  if (strategy == Strategy::CIRCLE || graph.size <= 2) return LayCircle(graph);
+  if (strategy == Strategy::PIVOT_MDS) return LayPivotMDS(graph);
+  if (strategy == Strategy::SPECTRAL) return LaySpectral(graph);
+
+  //almost-trees are laid along their block-cut tree
+  const Blocks blocks(graph);
+  if (blocks.Count() > 1) return LayBlocks(graph, blocks, strategy);
+  if (strategy == Strategy::AUTO && graph.size >= PIVOT_MDS_MIN) return LayPivotMDS(graph);
+  return LayCircle(graph);
+}
+
+Paint::Graph Math::ConnectedGraph::LayCircle(CSRView graph)
 {
   vector<Paint::Vertex> vertexes;
-  vector<Paint::Edge> edges;
+  Paint::Edges edges;
   const int R = Paint::Graph::AREA_SIZE / 2;
+  vertexes.reserve(graph.size);
+  edges.reserve(graph.Arcs() / 2);
 
-  for (u_int v = 0; v < adj_list.size(); ++v) {
-    double alpha = 2 * M_PI * v / adj_list.size();
+  for (u_int v = 0; v < graph.size; ++v) {
+    const double alpha = 2 * M_PI * v / graph.size;
     const Paint::Point p{
       static_cast<int>(R * (cos(alpha) + 1.)),
       static_cast<int>(R * (sin(alpha) + 1.))
     };
-    const int v_id = convert ? converter[v] : v;
+    const int v_id = graph.ids[v];
     vertexes.emplace_back(v_id, p);
+    for (u_int n : graph.Neighbours(v)) {
+      if (v < n) edges.emplace_back(v_id, static_cast<int>(graph.ids[n]));
+    }
+  }
+  return Paint::Graph(vertexes, move(edges));
+}
 
-    for (const auto n : adj_list[v]) {
-      if (v < n) {
-        alpha = 2 * M_PI * n / adj_list.size();
-        const Paint::Point p2{
-      static_cast<int>(R * (cos(alpha) + 1.)),
-      static_cast<int>(R * (sin(alpha) + 1.))
-        };
-        const int n_id = convert ? converter[n] : n;
-        edges.emplace_back(v_id, n_id);
+Paint::Graph Math::ConnectedGraph::LayBlocks(CSRView graph, const Blocks& blocks, Strategy strategy)
+{
+  const double HALF = Paint::Graph::AREA_SIZE / 2.;
+
+  //block-cut tree gives places of blocks and articulation points
+  const LayoutCSR bc_tree = LayoutCSR::FromAdjList(blocks.BlockCutTree());
+  const Paint::Graph bc = Tree::LayRadial(bc_tree.View());
+  const auto& nodes = bc.GetVertexes();
+  //the radial layout puts depth levels at this distance
+  const u_int depth = Tree::GetCenter(bc_tree.View()).second;
+  const double ring = HALF / max(1u, depth);
+
+  //lay the blocks in parallel, each one fits the circle of block_r radius
+  vector<Memory::Vector<Paint::Point, Memory::Stage::LAYOUT>> places(blocks.Count());
+  Parallel::For(0, blocks.Count(), [&](size_t b) {
+    const auto& block = blocks.GetBlock(b);
+    const Paint::Point center = nodes.at(b).p;
+    if (block.size() == 2) {
+      //bridge needs no own place: both ends are placed by the tree
+      places[b] = { center, center };
+      return;
+    }
+    //CSR of the block, it's ids are indexes in the block
+    unordered_map<u_int, u_int, hash<u_int>, equal_to<u_int>,
+      Memory::Allocator<pair<const u_int, u_int>, Memory::Stage::LAYOUT>> local;
+    for (u_int i = 0; i < block.size(); ++i) local[block[i]] = i;
+    LayoutCSR block_csr;
+    block_csr.offsets.reserve(block.size() + 1);
+    block_csr.ids.resize(block.size());
+    for (u_int i = 0; i < block.size(); ++i) {
+      block_csr.ids[i] = i;
+      block_csr.offsets.push_back(static_cast<u_int>(block_csr.targets.size()));
+      for (u_int n : graph.Neighbours(block[i])) {
+        auto it = local.find(n);
+        if (it != local.end()) block_csr.targets.push_back(it->second);
       }
     }
+    block_csr.offsets.push_back(static_cast<u_int>(block_csr.targets.size()));
+    //every block is a single block itself, so it's laid by circle or pivot MDS
+    const Paint::Graph laid = Lay(block_csr.View(), strategy);
+    const double block_r = 0.4 * ring;
+    places[b].resize(block.size());
+    for (const auto& [i, v] : laid.GetVertexes()) {
+      places[b][i] = Paint::Point{
+        static_cast<int>(center.x + (v.p.x - HALF) / HALF * block_r),
+        static_cast<int>(center.y + (v.p.y - HALF) / HALF * block_r)
+      };
+    }
+    }, 16);
 
+  vector<Paint::Vertex> vertexes;
+  Paint::Edges edges;
+  vertexes.reserve(graph.size);
+  edges.reserve(graph.Arcs() / 2);
+  for (u_int b = 0; b < blocks.Count(); ++b) {
+    const auto& block = blocks.GetBlock(b);
+    for (u_int i = 0; i < block.size(); ++i) {
+      const u_int v = block[i];
+      if (!blocks.IsArticulation(v)) {
+        vertexes.emplace_back(graph.ids[v], places[b][i]);
+      }
+    }
+  }
+  for (u_int v = 0; v < graph.size; ++v) {
+    //articulation points are laid once, at their tree node
+    if (blocks.IsArticulation(v)) {
+      vertexes.emplace_back(graph.ids[v], nodes.at(blocks.GetCutNode(v)).p);
+    }
+    for (u_int n : graph.Neighbours(v)) {
+      if (v < n) edges.emplace_back(graph.ids[v], graph.ids[n]);
+    }
   }
   return Paint::Graph(vertexes, move(edges));
 }
 
+Paint::Graph Math::ConnectedGraph::LayPivotMDS(CSRView graph, u_int pivots, bool refine)
+{
+  if (graph.size <= 2) return LayCircle(graph);
+  const DistanceLayout distances(graph, pivots);
+  Coordinates c = distances.Project();
+  if (refine) distances.Refine(c);
+  return ToPaintGraph(graph, c);
+}
+
+Paint::Graph Math::ConnectedGraph::LaySpectral(CSRView graph, bool refine)
+{
+  if (graph.size <= 2) return LayCircle(graph);
+  Coordinates c = SpectralLayout(graph);
+  if (refine) DistanceLayout(graph, 50).Refine(c);
+  return ToPaintGraph(graph, c);
+}
+
+Math::CSR Math::ConnectedGraph::ToCSR() const
+{
+  CSR csr = CSR::FromAdjList(adj_list);
+  if (convert) csr.ids.assign(converter.begin(), converter.end());
+  return csr;
+}
+
 
 /* Math::Tree */
 
 
 Paint::Graph Math::Tree::Lay() const
 {
-  vector<Paint::Vertex> vertexes;
-  vector<Paint::Edge> edges;
+  const CSR csr = ToCSR();
+  return Lay(csr.View(), tree_strategy);
+}
+
+Paint::Graph Math::Tree::Lay(CSRView tree, TreeStrategy tree_strategy)
+{
+  if (tree_strategy == TreeStrategy::TIDY) return LayTidy(tree);
+  return LayRadial(tree);
+}
 
-  const auto [C, R] = GetCenter();
+Paint::Graph Math::Tree::LayRadial(CSRView tree)
+{
+  vector<Paint::Vertex> vertexes;
+  Paint::Edges edges;
+  if (tree.size == 0) return Paint::Graph(vertexes, move(edges));
+
+  const auto [C, R] = GetCenter(tree);
+
+  //subtree sizes from BFS order, deepest vertexes first
+  vector<u_int> subtree(tree.size, 1);
+  {
+    vector<u_int> order;
+    vector<u_int> parent(tree.size, C);
+    order.reserve(tree.size);
+    order.push_back(C);
+    for (size_t i = 0; i < order.size(); ++i) {
+      for (u_int n : tree.Neighbours(order[i])) {
+        if (n != parent[order[i]]) {
+          parent[n] = order[i];
+          order.push_back(n);
+        }
+      }
+    }
+    for (size_t i = order.size() - 1; i > 0; --i) {
+      subtree[parent[order[i]]] += subtree[order[i]];
+    }
+  }
 
   //for every vertex keep number of it's child vertexes'
   //for central vertex it's all vertex count - 1
-  vector<u_int> ch_count(adj_list.size());
-  ch_count[C] = adj_list.size() - 1;
+  vector<u_int> ch_count(tree.size);
+  ch_count[C] = tree.size - 1;
   //for every vertex keep it's depth
   //for central vertex it's 0
-  vector<u_int> depth(adj_list.size());
+  vector<u_int> depth(tree.size);
   depth[C] = 0;
   //for every vertex keep it's outcoming angle sector for child vertexes
   //for central vertex it's sector is [0; 2 * M_PI]
-  vector<pair<double, double>> sectors(adj_list.size());
+  vector<pair<double, double>> sectors(tree.size);
   sectors[C] = { 0, 2 * M_PI };
   //for every vertex keep it's coordinates
   //for central vertex it's {AREA_SIZE / 2; AREA_SIZE / 2}
-  vector<Paint::Point> points(adj_list.size());
+  vector<Paint::Point> points(tree.size);
   points[C] = Paint::Point{ Paint::Graph::AREA_SIZE / 2, Paint::Graph::AREA_SIZE / 2 };
   //lay the central vertex
-  vertexes.emplace_back(convert ? converter[C] : C, points[C]);
+  vertexes.emplace_back(tree.ids[C], points[C]);
 
   //nextly use BFS to lay the tree radialy
-  vector<bool> visited(adj_list.size(), false);
+  vector<bool> visited(tree.size, false);
   queue<u_int> q;
   q.push(C);
   while (!q.empty()) {
@@ -232,11 +372,11 @@ Paint::Graph Math::Tree::Lay() const
     q.pop();
     visited[u] = true;
     double sector_begin = sectors[u].first;
-    for (u_int n : adj_list[u]) {
+    for (u_int n : tree.Neighbours(u)) {
       if (!visited[n]) {
         q.push(n);
         const auto [ps_begin, ps_end] = sectors[u];
-        ch_count[n] = GetChieldCount(n, u);
+        ch_count[n] = subtree[n] - 1;
         double alpha = (ps_end - ps_begin) * (1 + ch_count[n]) / static_cast<double>(ch_count[u]);
         sectors[n] = { sector_begin, sector_begin + alpha };
         sector_begin += alpha;
@@ -247,8 +387,8 @@ Paint::Graph Math::Tree::Lay() const
         static_cast<int>(r * cos(sectors[n].first + alpha / 2) + Paint::Graph::AREA_SIZE / 2),
         static_cast<int>(r * sin(sectors[n].first + alpha / 2) + Paint::Graph::AREA_SIZE / 2)
         };
-        const int u_id = convert ? converter[u] : u;
-        const int n_id = convert ? converter[n] : n;
+        const int u_id = tree.ids[u];
+        const int n_id = tree.ids[n];
         vertexes.emplace_back(n_id, points[n]);
         edges.emplace_back(u_id, n_id);
       }
@@ -265,46 +405,45 @@ bool Math::Tree::HasCycle() const
 
 std::pair<u_int, u_int> Math::Tree::GetCenter() const
 {
-  if (adj_list.empty())
+  const CSR csr = ToCSR();
+  return GetCenter(csr.View());
+}
+
+std::pair<u_int, u_int> Math::Tree::GetCenter(CSRView tree)
+{
+  if (tree.size == 0)
     return make_pair(0, 0);
 
-  vector<vector<int>> distances(
-    adj_list.size(), vector<int>(adj_list.size(), -1)
-  );
-  //using BFS for every vertex to get distance
-  for (int v = 0; v < distances.size(); ++v) {
-    distances[v][v] = 0;
+  //BFS distances and parents from the vertex
+  auto bfs = [&tree](u_int from, vector<u_int>& parent) {
+    vector<int> distances(tree.size, -1);
     queue<u_int> q;
-    vector<bool> visietd(distances.size(), false);
-    q.push(v);
+    q.push(from);
+    distances[from] = 0;
+    parent[from] = from;
+    u_int last = from;
     while (!q.empty()) {
-      u_int u = q.front();
+      last = q.front();
       q.pop();
-      visietd[u] = true;
-      for (u_int n : adj_list[u]) {
-        if (!visietd[n]) {
+      for (u_int n : tree.Neighbours(last)) {
+        if (distances[n] < 0) {
+          distances[n] = distances[last] + 1;
+          parent[n] = last;
           q.push(n);
-          distances[v][n] = distances[v][u] + 1;
         }
       }
     }
+    return make_pair(last, distances[last]);
+  };
+
+  //the farthest vertex from any vertex is an end of a diameter,
+  //the center is the middle of that diameter
+  vector<u_int> parent(tree.size);
+  const u_int a = bfs(0, parent).first;
+  const auto [b, diameter] = bfs(a, parent);
+  u_int center = b;
+  for (int step = 0; step < diameter / 2; ++step) {
+    center = parent[center];
   }
-
-  //counting the eccentricity of the vertices
-  vector<int> e(distances.size());
-  for (int v = 0; v < distances.size(); ++v) {
-    e[v] = *max_element(distances[v].begin(), distances[v].end());
-  }
-
-  auto v = min_element(e.begin(), e.end());
-  return make_pair(distance(e.begin(), v), *v);
-}
-
-u_int Math::Tree::GetChieldCount(u_int v, u_int parent) const
-{
-  vector<bool> visited(adj_list.size(), false);
-  visited[parent] = true;
-  int counter = -1;
-  DFS(v, visited, [&counter](u_int _) { counter++; });
-  return static_cast<u_int>(counter);
+  return make_pair(center, static_cast<u_int>(diameter - diameter / 2));
 }
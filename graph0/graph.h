@@ -4,6 +4,7 @@
 #include <unordered_map>
 
 #include "painter.h"
+#include "accounting.h"
 
 using std::vector;
 
@@ -20,13 +21,34 @@ namespace Paint {
     int to;
   };
 
+  //change of a graph, replayed on the copies of it
+  struct GraphEdit {
+    enum class Kind {
+      ADD_VERTEX, MOVE_VERTEX, REMOVE_VERTEX, ADD_EDGE, REMOVE_EDGE,
+    };
+    Kind kind;
+    //added or moved vertex, id of the removed one
+    Vertex vertex;
+    Edge edge{};
+    //index of the removed edge
+    size_t index = 0;
+  };
+
+  //laid graphs are accounted to the layout stage
+  using Vertexes = std::unordered_map<int, Vertex, std::hash<int>, std::equal_to<int>,
+    Memory::Allocator<std::pair<const int, Vertex>, Memory::Stage::LAYOUT>>;
+  using Edges = Memory::Vector<Edge, Memory::Stage::LAYOUT>;
+
   //VERTEX ID MUST BE UNIQUE!
   class Graph
   {
   public:
-    Graph(const vector<Vertex>& vs, vector<Edge> edges);
+    Graph(const vector<Vertex>& vs, Edges edges);
 
+    //every vertex adds ellipse and text, every edge adds line,
+    //in GetVertexes() and GetEdges() order
     void Render(Painter& p) const;
+    void Render(Scene& scene) const;
 
     void Scale(double rate);
     void ScaleX(double rate);
@@ -41,6 +63,19 @@ namespace Paint {
 
     void Rotate();
 
+    void MoveVertex(int id, Point p);
+
+    //single vertexes and edges of the edited graph
+    void AddVertex(Vertex v);
+    void RemoveVertex(int id);
+    //returns index of the edge in GetEdges()
+    size_t AddEdge(Edge e);
+    //the last edge takes index of the removed one
+    void RemoveEdge(size_t index);
+
+    const Vertexes& GetVertexes() const;
+    const Edges& GetEdges() const;
+
     int GetArea() const;
     int GetAreaW() const;
     int GetAreaH() const;
@@ -48,8 +83,8 @@ namespace Paint {
     static const int AREA_SIZE = 1000;
 
   private:
-    std::unordered_map<int, Vertex> vertexes;
-    vector<Edge> edges;
+    Vertexes vertexes;
+    Edges edges;
     int areaW = AREA_SIZE;
     int areaH = AREA_SIZE;
   };
@@ -60,6 +95,31 @@ namespace Math {
 
   class ConnectedGraph;
   class Tree;
+  class Blocks;
+  template<Memory::Stage S>
+  struct BasicCSR;
+  using CSR = BasicCSR<Memory::Stage::GRAPH>;
+  using LayoutCSR = BasicCSR<Memory::Stage::LAYOUT>;
+  struct CSRView;
+  class BitMatrix;
+
+  //how connected components which are not trees are laid
+  enum class Strategy {
+    //blocks for almost-trees, pivot MDS for big blocks, circle for the rest
+    AUTO,
+    CIRCLE,
+    BLOCKS,
+    PIVOT_MDS,
+    SPECTRAL,
+  };
+
+  //how tree components are laid
+  enum class TreeStrategy {
+    //levels on concentric circles around the center
+    RADIAL,
+    //levels on horizontal lines, Buchheim-Junger-Leipert tidy tree
+    TIDY,
+  };
 
   class Graph
   {
@@ -68,6 +128,7 @@ namespace Math {
     Graph(vector<vector<u_int>> adj_list);
 
     static vector<vector<u_int>> AdjListFromMatrix(const vector<vector<int>>& adj_matrix);
+    static vector<vector<u_int>> AdjListFromMatrix(const BitMatrix& adj_matrix);
 
     void ConvertOn();
     void ConvertOn(vector<u_int> c);
@@ -75,6 +136,13 @@ namespace Math {
 
     Paint::Graph Lay() const;
 
+    //lays single connectivity component straight from it's CSR slice
+    static Paint::Graph LayComponent(CSRView part,
+      Strategy strategy = Strategy::AUTO, TreeStrategy tree_strategy = TreeStrategy::RADIAL);
+
+    void SetStrategy(Strategy s);
+    void SetTreeStrategy(TreeStrategy s);
+
     bool HasCycle() const;
 
     template<typename Proc>
@@ -89,6 +157,8 @@ namespace Math {
     //converts vertexes id
     vector<u_int> converter;
     bool convert = false;
+    Strategy strategy = Strategy::AUTO;
+    TreeStrategy tree_strategy = TreeStrategy::RADIAL;
 
   private:
     bool CycleDFS(u_int start, u_int parent, vector<bool>& visited) const;
@@ -99,6 +169,23 @@ namespace Math {
   public:
     using Math::Graph::Graph;
     Paint::Graph Lay() const;
+
+    //the same over CSR of any connected graph, nothing is copied
+    static Paint::Graph Lay(CSRView graph, Strategy strategy);
+    //all vertexes on the circle
+    static Paint::Graph LayCircle(CSRView graph);
+    //every block on it's own, placed along the radially laid block-cut tree
+    static Paint::Graph LayBlocks(CSRView graph, const Blocks& blocks, Strategy strategy);
+    //projection of BFS distances from the pivots, optionally refined by stress
+    static Paint::Graph LayPivotMDS(CSRView graph, u_int pivots = 50, bool refine = true);
+    //Laplacian eigenvectors, optionally used as a warm start for stress refinement
+    static Paint::Graph LaySpectral(CSRView graph, bool refine = false);
+
+    //smaller blocks look better on the circle
+    static const u_int PIVOT_MDS_MIN = 64;
+
+  protected:
+    CSR ToCSR() const;
   };
 
 
@@ -108,10 +195,15 @@ namespace Math {
 
     Paint::Graph Lay() const;
     bool HasCycle() const;
+    //center vertex and it's eccentricity
     std::pair<u_int, u_int> GetCenter() const;
 
-  private:
-    u_int GetChieldCount(u_int v, u_int parent) const;
+    //the same over CSR of any tree, vertexes are local indexes
+    static Paint::Graph Lay(CSRView tree, TreeStrategy tree_strategy);
+    static Paint::Graph LayRadial(CSRView tree);
+    //layered layout rooted at the center, linear and without recursion
+    static Paint::Graph LayTidy(CSRView tree);
+    static std::pair<u_int, u_int> GetCenter(CSRView tree);
   };
 
 }
@@ -1,11 +1,29 @@
 #include "windows.h"
+#include "windowsx.h"
 #include "framework.h"
 #include "gdiplus.h"
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <exception>
 
 #include "graph0.h"
 #include "graph.h"
+#include "graph_view.h"
+#include "overview.h"
+#include "animation.h"
+#include "tiles.h"
+#include "metrics.h"
+#include "doutput.h"
+#include "graph_manager.h"
+#include "dynamic_graph.h"
+#include "sharding.h"
+#include "pipeline.h"
+#include "splitter.h"
 #include "painter.h"
 #include "IOcontroller.h"
+#include "accounting.h"
 
 #define MAX_LOADSTRING 100
 
@@ -15,12 +33,44 @@ WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
 WCHAR szWindowClass[MAX_LOADSTRING];            // the main window class name
 
 Paint::Painter PAINTER;
+GraphManager GRAPHS;
+std::shared_ptr<const GraphManager::Entry> CURRENT;
+size_t CURRENT_INDEX = 0;
+Math::Strategy STRATEGY = Math::Strategy::AUTO;
+Math::TreeStrategy TREE_STRATEGY = Math::TreeStrategy::RADIAL;
+std::optional<Paint::GraphView> VIEW;
+//clusters of the graph too big to be drawn whole
+std::optional<Paint::Overview> OVERVIEW;
+std::optional<Paint::Transition> TRANSITION;
+//the current graph once it's edited, lays only the touched components again
+std::optional<Math::DynamicGraph> EDITOR;
+//vertex picked with the right button, the next one gets or loses an edge with it
+std::optional<int> SELECTED;
+const UINT_PTR ANIMATION_TIMER = 1;
+//commands of the graph chooser menu, one per file
+const UINT ID_GRAPH_FIRST = 40000;
+//the sharded layout is posted back from it's thread, lParam owns ShardedResult
+const UINT WM_SHARDED = WM_APP + 1;
+struct ShardedResult {
+  //the graph it was laid for, it's shown only if that's still the current one
+  std::shared_ptr<const GraphManager::Entry> entry;
+  std::optional<Paint::Graph> laid;
+  std::exception_ptr error;
+};
+//one sharded layout runs at a time
+bool SHARDING = false;
 
 // Forward declarations of functions included in this code module:
 ATOM                MyRegisterClass(HINSTANCE hInstance);
 BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    About(HWND, UINT, WPARAM, LPARAM);
+void                ShowLayout(HWND, Paint::Graph);
+void                ShowOverview(HWND);
+void                OpenGraph(HWND, size_t);
+void                AddGraphMenu(HWND);
+void                ReportBudget(HWND, const Memory::BudgetExceeded&);
+void                EditGraph(HWND, const std::function<void(Math::DynamicGraph&)>&);
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
   _In_opt_ HINSTANCE hPrevInstance,
@@ -28,9 +78,19 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
   _In_ int       nCmdShow)
 {
   UNREFERENCED_PARAMETER(hPrevInstance);
-  UNREFERENCED_PARAMETER(lpCmdLine);
 
-  // TODO: Place code here.
+  //shard of the sharded layout, the process has no window
+  if (wcsncmp(lpCmdLine, Math::ShardedLayout::WORKER_FLAG, wcslen(Math::ShardedLayout::WORKER_FLAG)) == 0) {
+    return Math::ShardedLayout::Work(lpCmdLine);
+  }
+  //edge list bigger than the memory is split and laid by shards, without the window
+  if (wcsncmp(lpCmdLine, Math::ExternalSplitter::SPLIT_FLAG, wcslen(Math::ExternalSplitter::SPLIT_FLAG)) == 0) {
+    return Math::ExternalSplitter::Run(lpCmdLine);
+  }
+  //--memory-budget <MB> limits the memory of the pipeline stages together
+  if (const wchar_t* budget = wcsstr(lpCmdLine, L"--memory-budget")) {
+    Memory::SetBudget(static_cast<size_t>(wcstoull(budget + wcslen(L"--memory-budget"), nullptr, 10)) << 20);
+  }
 
   /* Initialize GDI+ */
   Gdiplus::GdiplusStartupInput gdiplusStartupInput;
@@ -79,7 +139,7 @@ ATOM MyRegisterClass(HINSTANCE hInstance)
 
   wcex.cbSize = sizeof(WNDCLASSEX);
 
-  wcex.style = CS_HREDRAW | CS_VREDRAW;
+  wcex.style = CS_HREDRAW | CS_VREDRAW | CS_DBLCLKS;
   wcex.lpfnWndProc = WndProc;
   wcex.cbClsExtra = 0;
   wcex.cbWndExtra = 0;
@@ -116,6 +176,9 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow)
     return FALSE;
   }
 
+  GRAPHS.SetFiles(GraphManager::FindGraphs("."));
+  AddGraphMenu(hWnd);
+
   ShowWindow(hWnd, nCmdShow);
   UpdateWindow(hWnd);
 
@@ -143,24 +206,28 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     switch (wmId)
     {
     case ID_FILE_STARTDRAWINGTHEGRAPH:
-      try {
-        Math::Graph graph(
-          Math::Graph::AdjListFromMatrix(IOcontroller::ReadMatrix("graph3.txt"))
-        );
-        PAINTER.Reset();
-        graph.Lay().Render(PAINTER);
-
-        //graphics update
-        RECT rect;
-        GetClientRect(hWnd, &rect);
-        InvalidateRect(hWnd, &rect, true);
+    {
+      const auto& files = GRAPHS.GetFiles();
+      const auto it = std::find(files.begin(), files.end(), "graph3.txt");
+      OpenGraph(hWnd, it == files.end() ? 0 : it - files.begin());
+    }
+    break;
+    case ID_FILE_NEXTGRAPH:
+      if (!GRAPHS.GetFiles().empty()) {
+        OpenGraph(hWnd, CURRENT ? (CURRENT_INDEX + 1) % GRAPHS.GetFiles().size() : 0);
       }
-      catch (...) {
-        MessageBox(hWnd, L"An error occurred while reading the graph!",
-          L"Input error", MB_OK);
+      break;
+    case ID_FILE_PREVIOUSGRAPH:
+      if (!GRAPHS.GetFiles().empty()) {
+        const size_t n = GRAPHS.GetFiles().size();
+        OpenGraph(hWnd, CURRENT ? (CURRENT_INDEX + n - 1) % n : 0);
       }
       break;
     default:
+      if (wmId >= ID_GRAPH_FIRST && wmId < ID_GRAPH_FIRST + GRAPHS.GetFiles().size()) {
+        OpenGraph(hWnd, wmId - ID_GRAPH_FIRST);
+        break;
+      }
       return DefWindowProc(hWnd, message, wParam, lParam);
     }
   }
@@ -178,8 +245,182 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     // TODO: Add any drawing code that uses hdc here...
     RECT rect;
     GetClientRect(hWnd, &rect);
-    PAINTER.Draw(hdc, rect.right - rect.left, rect.bottom - rect.top);
+    const bool complete = PAINTER.Draw(hdc, rect.right - rect.left, rect.bottom - rect.top, &ps.rcPaint);
     EndPaint(hWnd, &ps);
+    //the next slice is drawn when the message queue is idle again
+    if (!complete) InvalidateRect(hWnd, nullptr, false);
+  }
+  break;
+  case WM_ERASEBKGND:
+    //the back buffer covers the whole window
+    return 1;
+  case WM_TIMER:
+    if (wParam == ANIMATION_TIMER && TRANSITION) {
+      const bool running = TRANSITION->Step(PAINTER.GetScene());
+      PAINTER.Invalidate(running);
+      if (!running) {
+        KillTimer(hWnd, ANIMATION_TIMER);
+        TRANSITION.reset();
+      }
+      InvalidateRect(hWnd, nullptr, false);
+    }
+    break;
+  case WM_CHAR:
+    //1-5 lay the graph again with another strategy, t switches radial and tidy trees
+    if (CURRENT && !OVERVIEW && (wParam >= '1' && wParam <= '5' || wParam == 't' || wParam == 'T')) {
+      if (wParam == 't' || wParam == 'T') {
+        TREE_STRATEGY = TREE_STRATEGY == Math::TreeStrategy::RADIAL
+          ? Math::TreeStrategy::TIDY : Math::TreeStrategy::RADIAL;
+      }
+      else STRATEGY = static_cast<Math::Strategy>(wParam - '1');
+      EDITOR.reset();
+      SELECTED.reset();
+      try {
+        const Math::DynamicPipeline pipeline(Math::Policy::Dynamic{
+          .strategy = STRATEGY, .tree_strategy = TREE_STRATEGY });
+        ShowLayout(hWnd, pipeline.Lay(CURRENT->csr.View()));
+      }
+      catch (const Memory::BudgetExceeded& e) {
+        ReportBudget(hWnd, e);
+      }
+      catch (...) {
+        MessageBox(hWnd, L"An error occurred while laying the graph!",
+          L"Layout error", MB_OK);
+      }
+    }
+    //s lays the graph again in worker processes, the window doesn't wait for them
+    else if (CURRENT && !OVERVIEW && !SHARDING && (wParam == 's' || wParam == 'S')) {
+      SHARDING = true;
+      const Math::ShardedLayout::Settings settings{ .strategy = STRATEGY, .tree_strategy = TREE_STRATEGY };
+      std::thread([hWnd, settings, entry = CURRENT]() {
+        auto result = std::make_unique<ShardedResult>();
+        result->entry = entry;
+        try {
+          result->laid.emplace(Math::ShardedLayout(settings).Lay(entry->csr.View()));
+        }
+        catch (...) {
+          result->error = std::current_exception();
+        }
+        //the window is gone if the message can't be posted
+        if (PostMessage(hWnd, WM_SHARDED, 0, reinterpret_cast<LPARAM>(result.get()))) result.release();
+        }).detach();
+    }
+    //m prints quality of the current layout and memory of the stages to the debug output
+    else if ((VIEW || OVERVIEW) && (wParam == 'm' || wParam == 'M')) {
+      if (VIEW) {
+        const auto m = Paint::Measure(VIEW->GetGraph());
+        DOUT("crossings", m.crossings, "min separation", m.min_separation,
+          "edge length", m.edge_length_mean, "variance", m.edge_length_variance,
+          "area utilisation", m.area_utilisation);
+      }
+      Memory::Report();
+    }
+    //backspace goes from the cluster back to it's parent
+    else if (OVERVIEW && wParam == '\b') {
+      if (OVERVIEW->ZoomOut()) ShowOverview(hWnd);
+    }
+    //p saves the poster as png tiles
+    else if ((VIEW || OVERVIEW) && !TRANSITION && (wParam == 'p' || wParam == 'P')) {
+      try {
+        CreateDirectory(L"poster", nullptr);
+        Paint::TileRenderer(PAINTER, 16384, 16384).SavePNG(L"poster");
+      }
+      catch (...) {
+        MessageBox(hWnd, L"An error occurred while saving the poster!",
+          L"Output error", MB_OK);
+      }
+    }
+    break;
+  case WM_LBUTTONDOWN:
+    if (VIEW && !TRANSITION) {
+      const auto id = VIEW->Pick(PAINTER, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+      if (id) {
+        VIEW->BeginDrag(*id);
+        SetCapture(hWnd);
+      }
+    }
+    break;
+  case WM_LBUTTONDBLCLK:
+    //members of the cluster are laid when it's opened for the first time
+    if (OVERVIEW) {
+      const auto child = OVERVIEW->Pick(PAINTER, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+      try {
+        if (child && OVERVIEW->ZoomIn(*child)) ShowOverview(hWnd);
+      }
+      catch (const Memory::BudgetExceeded& e) {
+        ReportBudget(hWnd, e);
+      }
+      catch (...) {
+        MessageBox(hWnd, L"An error occurred while laying the cluster!",
+          L"Layout error", MB_OK);
+      }
+    }
+    break;
+  case WM_MOUSEMOVE:
+    if (VIEW && VIEW->IsDragging()) {
+      //repaint only the area around the dragged vertex
+      const RECT dirty = VIEW->Drag(PAINTER, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+      InvalidateRect(hWnd, &dirty, false);
+    }
+    break;
+  case WM_LBUTTONUP:
+    if (VIEW && VIEW->IsDragging()) {
+      //the edited graph keeps the vertex where it was dropped
+      const auto id = VIEW->EndDrag();
+      if (EDITOR && id) EDITOR->MoveVertex(*id, VIEW->GetGraph().GetVertexes().at(*id).p);
+      ReleaseCapture();
+    }
+    break;
+  case WM_RBUTTONDOWN:
+    //right click adds a vertex in the void, picks a vertex,
+    //or adds the edge between two picked ones, removes it if it's there
+    if (VIEW && !TRANSITION && !VIEW->IsDragging()) {
+      const auto id = VIEW->Pick(PAINTER, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+      if (!id) {
+        SELECTED.reset();
+        EditGraph(hWnd, [](Math::DynamicGraph& g) { g.AddVertex(); });
+      }
+      else if (!SELECTED || *SELECTED == *id) SELECTED = id;
+      else {
+        const u_int u = static_cast<u_int>(*SELECTED);
+        const u_int v = static_cast<u_int>(*id);
+        SELECTED.reset();
+        EditGraph(hWnd, [u, v](Math::DynamicGraph& g) {
+          if (g.HasEdge(u, v)) g.RemoveEdge(u, v);
+          else g.AddEdge(u, v);
+          });
+      }
+    }
+    break;
+  case WM_KEYDOWN:
+    //delete removes the picked vertex with it's edges
+    if (VIEW && !TRANSITION && wParam == VK_DELETE && SELECTED) {
+      const u_int v = static_cast<u_int>(*SELECTED);
+      SELECTED.reset();
+      EditGraph(hWnd, [v](Math::DynamicGraph& g) { g.RemoveVertex(v); });
+    }
+    else return DefWindowProc(hWnd, message, wParam, lParam);
+    break;
+  case WM_SHARDED:
+  {
+    std::unique_ptr<ShardedResult> result(reinterpret_cast<ShardedResult*>(lParam));
+    SHARDING = false;
+    //another graph or the overview was opened meanwhile
+    if (result->entry != CURRENT || OVERVIEW) break;
+    try {
+      if (result->error) std::rethrow_exception(result->error);
+      if (VIEW && VIEW->IsDragging()) ReleaseCapture();
+      EDITOR.reset();
+      SELECTED.reset();
+      ShowLayout(hWnd, std::move(*result->laid));
+    }
+    catch (const Memory::BudgetExceeded& e) {
+      ReportBudget(hWnd, e);
+    }
+    catch (...) {
+      MessageBox(hWnd, L"An error occurred while laying the graph in worker processes!",
+        L"Layout error", MB_OK);
+    }
   }
   break;
   case WM_DESTROY:
@@ -189,4 +430,108 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hWnd, message, wParam, lParam);
   }
   return 0;
-}
\ No newline at end of file
+}
+
+//shows the new layout, moving vertexes there from the previous one
+void ShowLayout(HWND hWnd, Paint::Graph laid)
+{
+  std::optional<Paint::Graph> previous;
+  if (VIEW) previous = VIEW->GetGraph();
+  OVERVIEW.reset();
+  PAINTER.Reset();
+  VIEW.emplace(std::move(laid));
+  VIEW->Render(PAINTER);
+  if (previous) {
+    TRANSITION.emplace(*previous, VIEW->GetGraph());
+    TRANSITION->Apply(PAINTER.GetScene(), 0);
+    PAINTER.Invalidate(true);
+    SetTimer(hWnd, ANIMATION_TIMER, 16, nullptr);
+  }
+  InvalidateRect(hWnd, nullptr, false);
+}
+
+//shows the current cluster of the overview, the graph view is dropped
+void ShowOverview(HWND hWnd)
+{
+  if (TRANSITION) {
+    KillTimer(hWnd, ANIMATION_TIMER);
+    TRANSITION.reset();
+  }
+  VIEW.reset();
+  PAINTER.Reset();
+  OVERVIEW->Render(PAINTER);
+  InvalidateRect(hWnd, nullptr, false);
+}
+
+//opens the graph from the chooser, neighbours are prefetched meanwhile
+void OpenGraph(HWND hWnd, size_t index)
+{
+  try {
+    CURRENT = GRAPHS.Open(index);
+    CURRENT_INDEX = index;
+    EDITOR.reset();
+    SELECTED.reset();
+    if (CURRENT->hierarchy) {
+      OVERVIEW.emplace(CURRENT->hierarchy);
+      ShowOverview(hWnd);
+    }
+    else ShowLayout(hWnd, CURRENT->layout.ToGraph(CURRENT->csr.View()));
+    Memory::Report();
+  }
+  catch (const Memory::BudgetExceeded& e) {
+    ReportBudget(hWnd, e);
+  }
+  catch (...) {
+    MessageBox(hWnd, L"An error occurred while reading the graph!",
+      L"Input error", MB_OK);
+  }
+}
+
+//menu with every graph file found
+void AddGraphMenu(HWND hWnd)
+{
+  const auto& files = GRAPHS.GetFiles();
+  if (files.empty()) return;
+  HMENU graphs = CreatePopupMenu();
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::wstring name(files[i].begin(), files[i].end());
+    AppendMenu(graphs, MF_STRING, ID_GRAPH_FIRST + i, name.c_str());
+  }
+  AppendMenu(GetMenu(hWnd), MF_POPUP, reinterpret_cast<UINT_PTR>(graphs), L"&Graphs");
+  DrawMenuBar(hWnd);
+}
+
+//edits the current graph, only the components the edit touched are laid again
+void EditGraph(HWND hWnd, const std::function<void(Math::DynamicGraph&)>& edit)
+{
+  try {
+    //the shown layout is kept, the touched components are laid as the keys chose
+    if (!EDITOR) {
+      EDITOR.emplace(CURRENT->csr.View().ToAdjList(), VIEW->GetGraph(), STRATEGY, TREE_STRATEGY);
+      edit(*EDITOR);
+      //the first edit shows the packed graph, the next ones patch it
+      ShowLayout(hWnd, EDITOR->Lay());
+      EDITOR->TakeEdits();
+      return;
+    }
+    edit(*EDITOR);
+    EDITOR->Lay();
+    VIEW->Apply(PAINTER, EDITOR->TakeEdits());
+    InvalidateRect(hWnd, nullptr, false);
+  }
+  catch (const Memory::BudgetExceeded& e) {
+    ReportBudget(hWnd, e);
+  }
+  catch (...) {
+    MessageBox(hWnd, L"An error occurred while editing the graph!",
+      L"Edit error", MB_OK);
+  }
+}
+
+//the stage which ran out of the memory budget
+void ReportBudget(HWND hWnd, const Memory::BudgetExceeded& e)
+{
+  //the cached graphs give their memory back, so the action may be tried again
+  GRAPHS.Trim();
+  MessageBoxA(hWnd, e.what(), "Memory budget", MB_OK);
+}
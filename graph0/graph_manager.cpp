@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "graph_manager.h"
+#include "pipeline.h"
+#include "IOcontroller.h"
+
+using namespace std;
+
+GraphManager::GraphManager(size_t budget)
+  : budget(budget), worker(&GraphManager::Work, this)
+{
+}
+
+GraphManager::~GraphManager()
+{
+  {
+    lock_guard<mutex> lock(guard);
+    stop = true;
+  }
+  cv.notify_all();
+  worker.join();
+}
+
+void GraphManager::SetFiles(vector<string> f)
+{
+  files = move(f);
+}
+
+const vector<string>& GraphManager::GetFiles() const
+{
+  return files;
+}
+
+vector<string> GraphManager::FindGraphs(const string& directory)
+{
+  vector<string> result;
+  error_code error;
+  for (const auto& entry : filesystem::directory_iterator(directory, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+      result.push_back(entry.path().filename().string());
+    }
+  }
+  sort(result.begin(), result.end());
+  return result;
+}
+
+shared_ptr<const GraphManager::Entry> GraphManager::Open(size_t index)
+{
+  const string& file = files.at(index);
+  shared_ptr<const Entry> entry;
+  {
+    unique_lock<mutex> lock(guard);
+    //the worker may be laying this very file, waiting is cheaper than doing it twice
+    cv.wait(lock, [&] { return !loading.count(file); });
+    auto it = cache.find(file);
+    if (it != cache.end()) {
+      lru.splice(lru.begin(), lru, it->second);
+      entry = it->second->second;
+    }
+    else {
+      //queued prefetch of this file isn't needed anymore
+      queue.erase(remove(queue.begin(), queue.end(), file), queue.end());
+    }
+  }
+  if (!entry) {
+    try {
+      entry = Load(file);
+    }
+    catch (const Memory::BudgetExceeded&) {
+      //the cache gives it's memory back before the user action fails
+      Trim();
+      entry = Load(file);
+    }
+    Insert(file, entry);
+  }
+  Prefetch(index);
+  return entry;
+}
+
+bool GraphManager::IsCached(const string& file) const
+{
+  lock_guard<mutex> lock(guard);
+  return cache.count(file) > 0;
+}
+
+void GraphManager::Trim()
+{
+  unique_lock<mutex> lock(guard);
+  queue.clear();
+  cv.wait(lock, [this] { return loading.empty(); });
+  for (auto it = lru.begin(); it != lru.end();) {
+    //the shown graph keeps it's memory anyway
+    if (it->second.use_count() > 1) {
+      ++it;
+      continue;
+    }
+    used -= it->second->bytes;
+    cache.erase(it->first);
+    it = lru.erase(it);
+  }
+}
+
+shared_ptr<const GraphManager::Entry> GraphManager::Load(const string& file)
+{
+  const Math::BitMatrix matrix = IOcontroller::ReadBitMatrix(file);
+  //the layout algorithms assume undirected graph
+  if (!matrix.IsSymmetric()) throw 0;
+  auto entry = make_shared<Entry>(Entry{ .csr = matrix.ToCSR() });
+  const Math::CSRView view = entry->csr.View();
+  if (view.size > Math::Hierarchy::DISPLAY_CAPACITY) {
+    entry->hierarchy = make_shared<const Math::Hierarchy>(view);
+  }
+  else {
+    //the saved layout is used if it's newer than the graph and has it's vertexes
+    const filesystem::path saved = file + LAYOUT_EXTENSION;
+    error_code error;
+    bool laid = false;
+    if (filesystem::last_write_time(saved, error) >= filesystem::last_write_time(file, error) && !error) {
+      try {
+        ifstream input(saved, ios::binary);
+        entry->layout = Paint::CompactLayout::Read(input);
+        laid = entry->layout.Matches(view);
+      }
+      catch (...) {
+      }
+    }
+    if (!laid) {
+      entry->layout = Paint::CompactLayout(Math::DefaultPipeline().Lay(view), view);
+      //the directory may be read-only, the layout is just not saved then
+      try {
+        ofstream output(saved, ios::binary);
+        if (output) entry->layout.Write(output);
+      }
+      catch (...) {
+      }
+    }
+  }
+
+  const auto& csr = entry->csr;
+  entry->bytes = sizeof(Entry)
+    + (csr.offsets.capacity() + csr.targets.capacity() + csr.ids.capacity()) * sizeof(u_int)
+    + entry->layout.Bytes()
+    + (entry->hierarchy ? entry->hierarchy->Bytes() : 0);
+  return entry;
+}
+
+size_t GraphManager::Limit() const
+{
+  const size_t memory = Memory::GetBudget();
+  return memory != 0 ? memory / BUDGET_SHARE : budget;
+}
+
+void GraphManager::Insert(const string& file, shared_ptr<const Entry> entry)
+{
+  lock_guard<mutex> lock(guard);
+  auto it = cache.find(file);
+  if (it != cache.end()) {
+    used -= it->second->second->bytes;
+    lru.erase(it->second);
+  }
+  used += entry->bytes;
+  lru.emplace_front(file, move(entry));
+  cache[file] = lru.begin();
+  //the newest entry stays even if it's over the budget alone
+  while (used > Limit() && lru.size() > 1) {
+    used -= lru.back().second->bytes;
+    cache.erase(lru.back().first);
+    lru.pop_back();
+  }
+}
+
+void GraphManager::Prefetch(size_t index)
+{
+  {
+    lock_guard<mutex> lock(guard);
+    queue.clear();
+    for (size_t neighbour : { index + 1, index - 1 }) {
+      if (neighbour >= files.size()) continue;
+      const string& file = files[neighbour];
+      if (!cache.count(file) && !loading.count(file)) queue.push_back(file);
+    }
+  }
+  cv.notify_all();
+}
+
+void GraphManager::Work()
+{
+  while (true) {
+    string file;
+    {
+      unique_lock<mutex> lock(guard);
+      cv.wait(lock, [this] { return stop || !queue.empty(); });
+      if (stop) return;
+      file = move(queue.front());
+      queue.pop_front();
+      //the prefetch doesn't take the memory the user actions need
+      if (Memory::GetBudget() != 0 && Memory::GetTotal().current >= Limit()) continue;
+      loading.insert(file);
+    }
+    shared_ptr<const Entry> entry;
+    try {
+      entry = Load(file);
+    }
+    catch (...) {
+      //broken files are reported when they are opened
+    }
+    if (entry) Insert(file, move(entry));
+    {
+      lock_guard<mutex> lock(guard);
+      loading.erase(file);
+    }
+    cv.notify_all();
+  }
+}
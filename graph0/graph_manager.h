@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "graph.h"
+#include "components.h"
+#include "hierarchy.h"
+#include "compact_layout.h"
+
+/* keeps recently opened graphs ready to show in LRU order within the cache budget,
+neighbours of the opened file are read and laid by the background thread.
+With the memory budget set the cache takes a share of it, the prefetch starts
+only while the share isn't used up, the rest is left to the user actions */
+class GraphManager {
+public:
+  struct Entry {
+    Math::CSR csr;
+    //positions of the laid graph, the edges are in the CSR
+    Paint::CompactLayout layout;
+    //clusters of the graph beyond the display capacity, it's not laid then
+    std::shared_ptr<const Math::Hierarchy> hierarchy;
+    //approximate memory of the entry
+    size_t bytes = 0;
+  };
+
+  //the budget is used when the memory budget isn't set
+  GraphManager(size_t budget = size_t(512) << 20);
+  GraphManager(const GraphManager&) = delete;
+  GraphManager& operator=(const GraphManager&) = delete;
+  ~GraphManager();
+
+  //files in the chooser order
+  void SetFiles(std::vector<std::string> files);
+  const std::vector<std::string>& GetFiles() const;
+  //*.txt files of the directory sorted by name
+  static std::vector<std::string> FindGraphs(const std::string& directory);
+
+  //laid graph from the cache, or loaded right now, then prefetches the neighbours
+  std::shared_ptr<const Entry> Open(size_t index);
+  bool IsCached(const std::string& file) const;
+  //drops the queued prefetches and the cached graphs nobody holds,
+  //waits for the prefetch being loaded to drop it too
+  void Trim();
+
+  //reads the matrix and the layout saved next to it, or lays it and saves the layout,
+  //clusters the graph if it's too big
+  static std::shared_ptr<const Entry> Load(const std::string& file);
+
+  //the layout of the graph file is saved in the file with this suffix
+  static constexpr const char* LAYOUT_EXTENSION = ".layout";
+  //the cache takes 1 / BUDGET_SHARE of the memory budget
+  static constexpr size_t BUDGET_SHARE = 2;
+
+private:
+  //bytes of the cache, the share of the memory budget if it's set
+  size_t Limit() const;
+  void Insert(const std::string& file, std::shared_ptr<const Entry> entry);
+  void Prefetch(size_t index);
+  void Work();
+
+private:
+  std::vector<std::string> files;
+  size_t budget;
+
+  mutable std::mutex guard;
+  std::condition_variable cv;
+  //the most recent entries go first
+  std::list<std::pair<std::string, std::shared_ptr<const Entry>>> lru;
+  std::unordered_map<std::string, decltype(lru)::iterator> cache;
+  size_t used = 0;
+  //files queued or being loaded by the worker
+  std::deque<std::string> queue;
+  std::unordered_set<std::string> loading;
+  bool stop = false;
+  std::thread worker;
+};
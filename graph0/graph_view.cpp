@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <string>
+
+#include "graph_view.h"
+
+using namespace std;
+
+Paint::GraphView::GraphView(Graph g)
+  : graph(move(g)), index(Graph::AREA_SIZE)
+{
+  //the same order Graph::Render adds objects in
+  size_t slot = 0;
+  ids.reserve(graph.GetVertexes().size());
+  for (const auto& [id, v] : graph.GetVertexes()) {
+    slots[id] = slot++;
+    ids.push_back(id);
+    index.Insert(id, v.p);
+  }
+  const auto& edges = graph.GetEdges();
+  for (size_t e = 0; e < edges.size(); ++e) {
+    incident[edges[e].from].push_back(e);
+    incident[edges[e].to].push_back(e);
+  }
+}
+
+void Paint::GraphView::Render(Painter& p) const
+{
+  graph.Render(p);
+}
+
+optional<int> Paint::GraphView::Pick(const Painter& p, int x, int y) const
+{
+  return index.Nearest(p.ToNotional(x, y), p.GetNotionalR());
+}
+
+void Paint::GraphView::BeginDrag(int id)
+{
+  if (!slots.count(id)) throw 0;
+  dragged = id;
+}
+
+bool Paint::GraphView::IsDragging() const
+{
+  return dragged.has_value();
+}
+
+RECT Paint::GraphView::Drag(Painter& p, int x, int y)
+{
+  if (!dragged) throw 0;
+  const int id = *dragged;
+  const Point from = graph.GetVertexes().at(id).p;
+  Point to = p.ToNotional(x, y);
+  to.x = clamp(to.x, 0, static_cast<int>(Graph::AREA_SIZE));
+  to.y = clamp(to.y, 0, static_cast<int>(Graph::AREA_SIZE));
+
+  MoveVertex(p.GetScene(), id, to);
+
+  //dirty box covers both positions and all incident edges
+  Point lt{ min(from.x, to.x), min(from.y, to.y) };
+  Point rb{ max(from.x, to.x), max(from.y, to.y) };
+  auto it = incident.find(id);
+  if (it != incident.end()) {
+    const auto& edges = graph.GetEdges();
+    for (size_t e : it->second) {
+      const Point other = graph.GetVertexes().at(edges[e].from == id ? edges[e].to : edges[e].from).p;
+      lt = Point{ min(lt.x, other.x), min(lt.y, other.y) };
+      rb = Point{ max(rb.x, other.x), max(rb.y, other.y) };
+    }
+  }
+  return p.ToWindow(lt, rb);
+}
+
+optional<int> Paint::GraphView::EndDrag()
+{
+  const optional<int> id = dragged;
+  dragged.reset();
+  return id;
+}
+
+void Paint::GraphView::Apply(Painter& p, const vector<GraphEdit>& edits)
+{
+  Scene& scene = p.GetScene();
+  for (const GraphEdit& edit : edits) {
+    switch (edit.kind) {
+    case GraphEdit::Kind::ADD_VERTEX:
+      AddVertex(scene, edit.vertex);
+      break;
+    case GraphEdit::Kind::MOVE_VERTEX:
+      MoveVertex(scene, edit.vertex.id, edit.vertex.p);
+      break;
+    case GraphEdit::Kind::REMOVE_VERTEX:
+      RemoveVertex(scene, edit.vertex.id);
+      break;
+    case GraphEdit::Kind::ADD_EDGE:
+      AddEdge(scene, edit.edge);
+      break;
+    case GraphEdit::Kind::REMOVE_EDGE:
+      RemoveEdge(scene, edit.index);
+      break;
+    }
+  }
+  //the picture is drawn again from the changed scene
+  p.Invalidate();
+}
+
+const Paint::Graph& Paint::GraphView::GetGraph() const
+{
+  return graph;
+}
+
+void Paint::GraphView::AddVertex(Scene& scene, Vertex v)
+{
+  graph.AddVertex(v);
+  index.Insert(v.id, v.p);
+  slots[v.id] = ids.size();
+  ids.push_back(v.id);
+  scene.AddEllipse(Paint::Ellipse{ .center = v.p });
+  scene.AddLabel(v.id, v.p);
+}
+
+void Paint::GraphView::MoveVertex(Scene& scene, int id, Point to)
+{
+  const Point from = graph.GetVertexes().at(id).p;
+  index.Move(id, from, to);
+  graph.MoveVertex(id, to);
+  scene.SetEllipse(slots.at(id), Paint::Ellipse{ .center = to });
+  scene.MoveLabel(slots.at(id), to);
+  auto it = incident.find(id);
+  if (it == incident.end()) return;
+  const auto& edges = graph.GetEdges();
+  for (size_t e : it->second) {
+    scene.SetLine(e, Paint::Line{
+      .from = graph.GetVertexes().at(edges[e].from).p,
+      .to = graph.GetVertexes().at(edges[e].to).p });
+  }
+}
+
+void Paint::GraphView::RemoveVertex(Scene& scene, int id)
+{
+  //the edges of the vertex are removed by their own edits
+  const size_t slot = slots.at(id);
+  index.Remove(id, graph.GetVertexes().at(id).p);
+  graph.RemoveVertex(id);
+  scene.RemoveEllipse(slot);
+  scene.RemoveLabel(slot);
+  ids[slot] = ids.back();
+  slots[ids[slot]] = slot;
+  ids.pop_back();
+  slots.erase(id);
+  if (dragged == id) dragged.reset();
+}
+
+void Paint::GraphView::AddEdge(Scene& scene, Edge e)
+{
+  const size_t index = graph.AddEdge(e);
+  scene.AddLine(Paint::Line{
+    .from = graph.GetVertexes().at(e.from).p,
+    .to = graph.GetVertexes().at(e.to).p });
+  incident[e.from].push_back(index);
+  incident[e.to].push_back(index);
+}
+
+void Paint::GraphView::RemoveEdge(Scene& scene, size_t e)
+{
+  const auto& edges = graph.GetEdges();
+  const size_t last = edges.size() - 1;
+  //replaces the edge index in the list of the vertex, drops the empty lists
+  const auto relink = [this](int id, size_t from, optional<size_t> to) {
+    auto it = incident.find(id);
+    if (it == incident.end()) throw 0;
+    auto& list = it->second;
+    auto pos = find(list.begin(), list.end(), from);
+    if (pos == list.end()) throw 0;
+    if (to) *pos = *to;
+    else {
+      *pos = list.back();
+      list.pop_back();
+      if (list.empty()) incident.erase(it);
+    }
+  };
+  relink(edges.at(e).from, e, nullopt);
+  relink(edges.at(e).to, e, nullopt);
+  if (last != e) {
+    relink(edges[last].from, last, e);
+    relink(edges[last].to, last, e);
+  }
+  graph.RemoveEdge(e);
+  scene.RemoveLine(e);
+}
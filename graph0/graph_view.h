@@ -0,0 +1,56 @@
+#pragma once
+#include <optional>
+#include <unordered_map>
+
+#include "graph.h"
+#include "quadtree.h"
+
+namespace Paint {
+
+  /* drawn graph which can be edited with the mouse:
+  keeps the spatial index of vertexes and knows which painter
+  objects belong to which vertex, so dragging touches only them */
+  class GraphView
+  {
+  public:
+    GraphView(Graph graph);
+
+    void Render(Painter& p) const;
+
+    //vertex under the window point
+    std::optional<int> Pick(const Painter& p, int x, int y) const;
+
+    void BeginDrag(int id);
+    bool IsDragging() const;
+    //moves dragged vertex to the window point,
+    //returns window rect that needs repainting
+    RECT Drag(Painter& p, int x, int y);
+    //returns the dragged vertex
+    std::optional<int> EndDrag();
+
+    //replays the edits of the graph on it and on it's painter objects,
+    //only the edited ones are touched
+    void Apply(Painter& p, const std::vector<GraphEdit>& edits);
+
+    const Graph& GetGraph() const;
+
+  private:
+    void AddVertex(Scene& scene, Vertex v);
+    void MoveVertex(Scene& scene, int id, Point to);
+    void RemoveVertex(Scene& scene, int id);
+    void AddEdge(Scene& scene, Edge e);
+    //the last edge takes the index of the removed one, like in the graph
+    void RemoveEdge(Scene& scene, size_t e);
+
+  private:
+    Graph graph;
+    QuadTree index;
+    //vertex id -> index of it's ellipse and text in painter and back
+    std::unordered_map<int, size_t> slots;
+    vector<int> ids;
+    //vertex id -> indexes of incident edges
+    std::unordered_map<int, vector<size_t>> incident;
+    std::optional<int> dragged;
+  };
+
+}
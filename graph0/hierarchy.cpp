@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <unordered_map>
+
+#include "hierarchy.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  //the same for the same node and round, independent between them
+  uint64_t Mix(uint64_t x, uint64_t round)
+  {
+    x += 0x9E3779B97F4A7C15ull * (round + 1);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+}
+
+Math::Hierarchy::Hierarchy(CSRView graph, u_int capacity)
+  : graph(graph)
+{
+  //a single child per node would never get to the root
+  if (capacity < 2) throw 0;
+  levels.emplace_back();
+  levels[0].count = graph.size;
+
+  if (graph.size > capacity) {
+    //components small enough to be shown whole keep the label of their least vertex
+    const Components components(graph);
+    vector<u_int> first(components.Count(), static_cast<u_int>(-1));
+    vector<u_int> labels(graph.size);
+    vector<bool> fixed(graph.size);
+    for (u_int v = 0; v < graph.size; ++v) {
+      const u_int c = components.GetComponent(v);
+      if (first[c] == static_cast<u_int>(-1)) first[c] = v;
+      fixed[v] = components.Slice(c).size <= capacity;
+      labels[v] = fixed[v] ? first[c] : v;
+    }
+    labels = PropagateLabels(graph, {}, move(labels), fixed);
+    Cap(graph, labels, capacity);
+    AddLevel(labels);
+
+    while (levels.back().count > capacity) {
+      const Level& top = levels.back();
+      const u_int count = top.count;
+      vector<u_int> l(count);
+      iota(l.begin(), l.end(), 0);
+      l = PropagateLabels(top.adjacency.View(), top.weights, move(l), vector<bool>(count));
+
+      //numbered in the order of the first node, so the neighbouring indexes
+      //are close in the graph, propagation which stalls is helped by grouping them
+      vector<u_int> number(count, static_cast<u_int>(-1));
+      u_int k = 0;
+      for (u_int& label : l) {
+        if (number[label] == static_cast<u_int>(-1)) number[label] = k++;
+        label = number[label];
+      }
+      if (k > count - count / 10) {
+        for (u_int& label : l) label = static_cast<u_int>(static_cast<uint64_t>(label) * capacity / k);
+      }
+      Cap(top.adjacency.View(), l, capacity);
+      AddLevel(l);
+      //a level which doesn't shrink would be added forever
+      if (levels.back().count >= count) throw 0;
+    }
+  }
+
+  vector<u_int> root(levels.back().count, 0);
+  AddLevel(root);
+}
+
+u_int Math::Hierarchy::Levels() const
+{
+  return static_cast<u_int>(levels.size());
+}
+
+u_int Math::Hierarchy::Root() const
+{
+  return Levels() - 1;
+}
+
+u_int Math::Hierarchy::Count(u_int level) const
+{
+  return levels.at(level).count;
+}
+
+u_int Math::Hierarchy::Size(u_int level, u_int node) const
+{
+  return level == 0 ? 1 : levels.at(level).sizes.at(node);
+}
+
+u_int Math::Hierarchy::Parent(u_int level, u_int node) const
+{
+  return levels.at(level).parents.at(node);
+}
+
+span<const u_int> Math::Hierarchy::Children(u_int level, u_int node) const
+{
+  if (level == 0) return {};
+  const Level& l = levels.at(level);
+  return span<const u_int>(l.children.data() + l.child_offsets.at(node),
+    l.children.data() + l.child_offsets.at(node + 1));
+}
+
+Math::CSRView Math::Hierarchy::Adjacency(u_int level) const
+{
+  return level == 0 ? graph : levels.at(level).adjacency.View();
+}
+
+span<const u_int> Math::Hierarchy::Weights(u_int level) const
+{
+  //every arc of the graph weighs 1
+  return level == 0 ? span<const u_int>() : span<const u_int>(levels.at(level).weights);
+}
+
+Math::CSR Math::Hierarchy::Members(u_int level, u_int node) const
+{
+  if (level == 0) throw 0;
+  const auto children = Children(level, node);
+  const CSRView lower = Adjacency(level - 1);
+  unordered_map<u_int, u_int> local;
+  local.reserve(children.size());
+  for (u_int i = 0; i < children.size(); ++i) local[children[i]] = i;
+
+  CSR result;
+  result.ids.assign(children.begin(), children.end());
+  result.offsets.reserve(children.size() + 1);
+  result.offsets.push_back(0);
+  for (u_int child : children) {
+    for (u_int t : lower.Neighbours(child)) {
+      if (Parent(level - 1, t) == node) result.targets.push_back(local.at(t));
+    }
+    result.offsets.push_back(static_cast<u_int>(result.targets.size()));
+  }
+  return result;
+}
+
+size_t Math::Hierarchy::Bytes() const
+{
+  size_t bytes = levels.capacity() * sizeof(Level);
+  for (const Level& l : levels) {
+    bytes += (l.adjacency.offsets.capacity() + l.adjacency.targets.capacity() + l.adjacency.ids.capacity()
+      + l.weights.capacity() + l.sizes.capacity() + l.parents.capacity()
+      + l.child_offsets.capacity() + l.children.capacity()) * sizeof(u_int);
+  }
+  return bytes;
+}
+
+vector<u_int> Math::Hierarchy::PropagateLabels(CSRView graph, span<const u_int> weights,
+  vector<u_int> labels, const vector<bool>& fixed)
+{
+  //the half updated in a round reads the labels of the previous one,
+  //so neighbours rarely swap labels and the result doesn't depend on threads
+  vector<u_int> next = labels;
+  for (u_int round = 0; round < ROUNDS; ++round) {
+    atomic<size_t> changed = 0;
+    Parallel::ForChunks(0, graph.size, [&](size_t, size_t from, size_t to) {
+      vector<pair<u_int, u_int>> counts;
+      size_t local = 0;
+      for (size_t v = from; v < to; ++v) {
+        if (fixed[v] || (Mix(v, round) & 1)) continue;
+        counts.clear();
+        for (u_int k = graph.offsets[v]; k < graph.offsets[v + 1]; ++k) {
+          counts.emplace_back(labels[graph.targets[k]], weights.empty() ? 1 : weights[k]);
+        }
+        if (counts.empty()) continue;
+        sort(counts.begin(), counts.end());
+
+        //the heaviest label, ties are broken at random
+        u_int best = labels[v];
+        uint64_t best_weight = 0;
+        uint64_t best_tie = 0;
+        for (size_t i = 0; i < counts.size();) {
+          const u_int label = counts[i].first;
+          uint64_t weight = 0;
+          for (; i < counts.size() && counts[i].first == label; ++i) weight += counts[i].second;
+          const uint64_t tie = Mix(label, round + ROUNDS);
+          if (weight > best_weight || (weight == best_weight && tie < best_tie)) {
+            best = label;
+            best_weight = weight;
+            best_tie = tie;
+          }
+        }
+        if (best != labels[v]) {
+          next[v] = best;
+          local++;
+        }
+      }
+      changed += local;
+      }, 1 << 12);
+    labels = next;
+    if (changed <= graph.size / 1000) break;
+  }
+  return labels;
+}
+
+void Math::Hierarchy::Cap(CSRView graph, vector<u_int>& labels, u_int capacity)
+{
+  const u_int n = graph.size;
+  const u_int NONE = static_cast<u_int>(-1);
+  //there are no more communities than nodes, so the parts are numbered after the labels
+  vector<u_int> number(n, NONE);
+  u_int k = 0;
+  for (u_int& label : labels) {
+    if (number[label] == NONE) number[label] = k++;
+    label = number[label];
+  }
+  vector<u_int> sizes(k, 0);
+  for (u_int label : labels) sizes[label]++;
+
+  //the first part keeps the label, the BFS trees of a community fill it's parts
+  //one after another, so the pieces without edges between them are packed too
+  vector<bool> seen(n, false);
+  vector<u_int> part(k);
+  iota(part.begin(), part.end(), 0);
+  vector<u_int> used(k, 0);
+  vector<u_int> queue;
+  for (u_int s = 0; s < n; ++s) {
+    if (seen[s] || sizes[labels[s]] <= capacity) continue;
+    const u_int label = labels[s];
+    queue.assign(1, s);
+    seen[s] = true;
+    for (size_t head = 0; head < queue.size(); ++head) {
+      const u_int v = queue[head];
+      if (used[label] == capacity) {
+        part[label] = k++;
+        used[label] = 0;
+      }
+      labels[v] = part[label];
+      used[label]++;
+      for (u_int t : graph.Neighbours(v)) {
+        if (!seen[t] && labels[t] == label) {
+          seen[t] = true;
+          queue.push_back(t);
+        }
+      }
+    }
+  }
+}
+
+void Math::Hierarchy::AddLevel(vector<u_int>& labels)
+{
+  Level& prev = levels.back();
+  const u_int n = prev.count;
+  const CSRView adjacency = Adjacency(Levels() - 1);
+  const auto weights = Weights(Levels() - 1);
+
+  //labels numbered in the order of their first node
+  vector<u_int> number(n, static_cast<u_int>(-1));
+  Level level;
+  for (u_int& label : labels) {
+    if (number[label] == static_cast<u_int>(-1)) number[label] = level.count++;
+    label = number[label];
+  }
+  prev.parents = move(labels);
+  const auto& parents = prev.parents;
+
+  level.sizes.assign(level.count, 0);
+  level.child_offsets.assign(level.count + 1, 0);
+  for (u_int v = 0; v < n; ++v) {
+    level.sizes[parents[v]] += prev.sizes.empty() ? 1 : prev.sizes[v];
+    level.child_offsets[parents[v]]++;
+  }
+  Parallel::PrefixSum(level.child_offsets);
+  level.children.resize(n);
+  {
+    vector<u_int> fill(level.child_offsets.begin(), level.child_offsets.end() - 1);
+    for (u_int v = 0; v < n; ++v) level.children[fill[parents[v]]++] = v;
+  }
+
+  //arcs between different clusters, merged by their ends
+  vector<vector<pair<uint64_t, u_int>>> parts(Parallel::Threads());
+  Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+    auto& part = parts[chunk];
+    for (size_t v = from; v < to; ++v) {
+      for (u_int k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; ++k) {
+        const u_int a = parents[v];
+        const u_int b = parents[adjacency.targets[k]];
+        if (a != b) part.emplace_back(static_cast<uint64_t>(a) << 32 | b, weights.empty() ? 1 : weights[k]);
+      }
+    }
+    }, 1 << 12);
+  vector<pair<uint64_t, u_int>> arcs;
+  for (auto& part : parts) {
+    arcs.insert(arcs.end(), part.begin(), part.end());
+    vector<pair<uint64_t, u_int>>().swap(part);
+  }
+  sort(arcs.begin(), arcs.end());
+
+  CSR& csr = level.adjacency;
+  csr.offsets.assign(level.count + 1, 0);
+  csr.ids.resize(level.count);
+  iota(csr.ids.begin(), csr.ids.end(), 0);
+  for (size_t i = 0; i < arcs.size();) {
+    const uint64_t key = arcs[i].first;
+    u_int weight = 0;
+    for (; i < arcs.size() && arcs[i].first == key; ++i) weight += arcs[i].second;
+    csr.offsets[key >> 32]++;
+    csr.targets.push_back(static_cast<u_int>(key));
+    level.weights.push_back(weight);
+  }
+  Parallel::PrefixSum(csr.offsets);
+
+  levels.push_back(move(level));
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <span>
+
+#include "graph.h"
+#include "components.h"
+
+namespace Math {
+
+  /* clusters of clusters over a graph too big to be drawn vertex by vertex:
+  level 0 is the graph itself, level 1 keeps small connectivity components whole
+  and splits big ones into communities by label propagation, every next level
+  propagates labels over the aggregated graph of the previous one. Communities
+  with more nodes than the display capacity are split in BFS order, so every
+  node has at most capacity children. The last level is a single root.
+  The graph arrays must outlive the hierarchy */
+  class Hierarchy
+  {
+  public:
+    Hierarchy(CSRView graph, u_int capacity = DISPLAY_CAPACITY);
+
+    //including the graph level and the root level
+    u_int Levels() const;
+    u_int Root() const;
+    u_int Count(u_int level) const;
+    //count of graph vertexes in the node
+    u_int Size(u_int level, u_int node) const;
+    u_int Parent(u_int level, u_int node) const;
+    //nodes of the level below
+    std::span<const u_int> Children(u_int level, u_int node) const;
+
+    //aggregated graph of the level, ids are node indexes, level 0 is the graph
+    CSRView Adjacency(u_int level) const;
+    //count of graph edges behind every arc of Adjacency(level)
+    std::span<const u_int> Weights(u_int level) const;
+    //subgraph induced by the children of the node, ids are indexes in the level below
+    CSR Members(u_int level, u_int node) const;
+    //allocated memory, without the graph
+    size_t Bytes() const;
+
+    //vertexes a drawing can show, bigger graphs are shown by clusters
+    static const u_int DISPLAY_CAPACITY = 2000;
+
+  private:
+    struct Level {
+      u_int count = 0;
+      CSR adjacency;
+      std::vector<u_int> weights;
+      std::vector<u_int> sizes;
+      //node of the next level
+      std::vector<u_int> parents;
+      //CSR of nodes of the previous level
+      std::vector<u_int> child_offsets;
+      std::vector<u_int> children;
+    };
+
+    //labels of the small components are fixed, the others take the heaviest
+    //label of their neighbours, half of the nodes at a time
+    static std::vector<u_int> PropagateLabels(CSRView graph, std::span<const u_int> weights,
+      std::vector<u_int> labels, const std::vector<bool>& fixed);
+    //numbers the labels from 0, communities bigger than the capacity are cut into
+    //parts of the capacity along the BFS over their own edges, the BFS trees
+    //fill the parts one after another
+    static void Cap(CSRView graph, std::vector<u_int>& labels, u_int capacity);
+    //numbers the labels from 0 and adds the level grouping the previous one by them
+    void AddLevel(std::vector<u_int>& labels);
+
+    static const u_int ROUNDS = 30;
+
+  private:
+    CSRView graph;
+    std::vector<Level> levels;
+  };
+
+}
@@ -0,0 +1,191 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+#include "mds.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  //dominant eigenpair of symmetric k x k matrix by power iteration
+  double PowerIteration(const vector<double>& m, u_int k, vector<double>& v)
+  {
+    v.assign(k, 0);
+    for (u_int j = 0; j < k; ++j) v[j] = 1. + j % 7;
+    double lambda = 0;
+    vector<double> w(k);
+    for (int it = 0; it < 300; ++it) {
+      double norm = 0;
+      for (u_int a = 0; a < k; ++a) {
+        w[a] = 0;
+        for (u_int b = 0; b < k; ++b) w[a] += m[a * k + b] * v[b];
+        norm += w[a] * w[a];
+      }
+      norm = sqrt(norm);
+      if (norm < 1e-12) break;
+      for (u_int a = 0; a < k; ++a) v[a] = w[a] / norm;
+      if (abs(norm - lambda) < 1e-9 * norm) {
+        lambda = norm;
+        break;
+      }
+      lambda = norm;
+    }
+    return lambda;
+  }
+
+}
+
+Math::DistanceLayout::DistanceLayout(CSRView g, u_int k)
+  : graph(g)
+{
+  k = min(max(k, 3u), graph.size);
+
+  //random distinct pivots, the seed is fixed to keep the picture stable
+  vector<u_int> order(graph.size);
+  for (u_int v = 0; v < graph.size; ++v) order[v] = v;
+  mt19937 rng(0);
+  for (u_int i = 0; i < k; ++i) {
+    swap(order[i], order[i + rng() % (graph.size - i)]);
+  }
+  pivots.assign(order.begin(), order.begin() + k);
+
+  //one BFS per pivot, they are independent
+  distances.resize(k);
+  Parallel::For(0, k, [this](size_t p) {
+    const u_int NONE = static_cast<u_int>(-1);
+    auto& d = distances[p];
+    d.assign(graph.size, NONE);
+    vector<u_int> frontier = { pivots[p] };
+    d[pivots[p]] = 0;
+    for (size_t i = 0; i < frontier.size(); ++i) {
+      const u_int u = frontier[i];
+      for (u_int n : graph.Neighbours(u)) {
+        if (d[n] == NONE) {
+          d[n] = d[u] + 1;
+          frontier.push_back(n);
+        }
+      }
+    }
+    }, 1);
+}
+
+Math::Coordinates Math::DistanceLayout::Project() const
+{
+  const u_int n = graph.size;
+  const u_int k = pivots.size();
+  auto sq = [this](u_int v, u_int p) {
+    return static_cast<double>(distances[p][v]) * distances[p][v];
+  };
+
+  //double centering of squared distances, C is never stored
+  vector<double> row_mean(n);
+  vector<double> col_mean(k);
+  Parallel::For(0, n, [&](size_t v) {
+    double s = 0;
+    for (u_int p = 0; p < k; ++p) s += sq(v, p);
+    row_mean[v] = s / k;
+    });
+  Parallel::For(0, k, [&](size_t p) {
+    double s = 0;
+    for (u_int v = 0; v < n; ++v) s += sq(v, p);
+    col_mean[p] = s / n;
+    }, 1);
+  double total = 0;
+  for (double m : col_mean) total += m;
+  total /= k;
+  auto centered = [&](u_int v, u_int p) {
+    return -0.5 * (sq(v, p) - row_mean[v] - col_mean[p] + total);
+  };
+
+  //k x k matrix C^T * C, summed over the chunks
+  vector<vector<double>> partial(Parallel::Threads(), vector<double>(k * k, 0));
+  Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+    auto& m = partial[chunk];
+    vector<double> row(k);
+    for (size_t v = from; v < to; ++v) {
+      for (u_int p = 0; p < k; ++p) row[p] = centered(v, p);
+      for (u_int a = 0; a < k; ++a) {
+        for (u_int b = 0; b < k; ++b) m[a * k + b] += row[a] * row[b];
+      }
+    }
+    }, 1 << 10);
+  vector<double> ctc(k * k, 0);
+  for (const auto& m : partial) {
+    for (size_t i = 0; i < m.size(); ++i) ctc[i] += m[i];
+  }
+
+  //two dominant eigenvectors, the second one after deflation
+  vector<double> v1, v2;
+  const double l1 = PowerIteration(ctc, k, v1);
+  for (u_int a = 0; a < k; ++a) {
+    for (u_int b = 0; b < k; ++b) ctc[a * k + b] -= l1 * v1[a] * v1[b];
+  }
+  const double l2 = PowerIteration(ctc, k, v2);
+
+  //C * v has the norm of the singular value, MDS wants it's square root
+  const double s1 = l1 > 0 ? pow(l1, 0.25) : 1.;
+  const double s2 = l2 > 0 ? pow(l2, 0.25) : 1.;
+  Coordinates c;
+  c.x.resize(n);
+  c.y.resize(n);
+  Parallel::For(0, n, [&](size_t v) {
+    double x = 0, y = 0;
+    for (u_int p = 0; p < k; ++p) {
+      const double cvp = centered(v, p);
+      x += cvp * v1[p];
+      y += cvp * v2[p];
+    }
+    c.x[v] = x / s1;
+    c.y[v] = y / s2;
+    });
+  return c;
+}
+
+void Math::DistanceLayout::Refine(Coordinates& c, u_int iterations) const
+{
+  const u_int n = graph.size;
+  if (n < 3) return;
+
+  //scale to the unit mean edge length first
+  double length = 0;
+  for (u_int v = 0; v < n; ++v) {
+    for (u_int u : graph.Neighbours(v)) {
+      length += hypot(c.x[v] - c.x[u], c.y[v] - c.y[u]);
+    }
+  }
+  length /= max<size_t>(1, graph.Arcs());
+  if (length < 1e-12) length = 1;
+  for (u_int v = 0; v < n; ++v) {
+    c.x[v] /= length;
+    c.y[v] /= length;
+  }
+
+  //Jacobi steps of stress majorization: every vertex moves
+  //to the weighted mean of the places where it's distances are ideal
+  Coordinates next = c;
+  for (u_int it = 0; it < iterations; ++it) {
+    Parallel::For(0, n, [&](size_t v) {
+      double sx = 0, sy = 0, ws = 0;
+      auto attract = [&](u_int u, double d, double w) {
+        const double dx = c.x[v] - c.x[u];
+        const double dy = c.y[v] - c.y[u];
+        const double len = max(hypot(dx, dy), 1e-9);
+        sx += w * (c.x[u] + d * dx / len);
+        sy += w * (c.y[u] + d * dy / len);
+        ws += w;
+      };
+      for (u_int u : graph.Neighbours(v)) attract(u, 1., 1.);
+      for (u_int p = 0; p < pivots.size(); ++p) {
+        const double d = distances[p][v];
+        if (d > 1) attract(pivots[p], d, 1. / (d * d));
+      }
+      if (ws > 0) {
+        next.x[v] = sx / ws;
+        next.y[v] = sy / ws;
+      }
+      }, 1 << 10);
+    swap(c, next);
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+
+#include "coordinates.h"
+
+namespace Math {
+
+  /* distance-based layout of a connected graph:
+  BFS distances are computed from k pivots only, so the cost
+  is O(k * (V + E)) instead of all pairs */
+  class DistanceLayout
+  {
+  public:
+    DistanceLayout(CSRView graph, u_int pivots);
+
+    //pivot MDS: classical scaling of the V x k distance matrix
+    Coordinates Project() const;
+    //sparse stress majorization over the edges and the pivots
+    void Refine(Coordinates& c, u_int iterations = 30) const;
+
+  private:
+    CSRView graph;
+    vector<u_int> pivots;
+    //distances[p][v] from p-th pivot to v
+    Memory::Vector<Memory::Vector<u_int, Memory::Stage::LAYOUT>, Memory::Stage::LAYOUT> distances;
+  };
+
+}
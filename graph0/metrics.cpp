@@ -0,0 +1,310 @@
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+#include <atomic>
+
+#include "metrics.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  using Paint::Point;
+
+  struct Segment {
+    Point a;
+    Point b;
+    //vertex indexes of the ends, edges sharing one don't cross
+    size_t u;
+    size_t v;
+  };
+
+  struct Snapshot {
+    vector<Point> points;
+    vector<Segment> segments;
+  };
+
+  Snapshot Take(const Paint::Graph& graph)
+  {
+    Snapshot s;
+    unordered_map<int, size_t> index;
+    index.reserve(graph.GetVertexes().size());
+    s.points.reserve(graph.GetVertexes().size());
+    for (const auto& [id, v] : graph.GetVertexes()) {
+      index[id] = s.points.size();
+      s.points.push_back(v.p);
+    }
+    const auto& edges = graph.GetEdges();
+    s.segments.resize(edges.size());
+    Parallel::For(0, edges.size(), [&](size_t e) {
+      const size_t u = index.at(edges[e].from);
+      const size_t v = index.at(edges[e].to);
+      s.segments[e] = Segment{ s.points[u], s.points[v], u, v };
+      });
+    return s;
+  }
+
+  //uniform square grid over the box of the points,
+  //about the given count of cells, scale makes them bigger
+  struct Grid {
+    Grid(const vector<Point>& points, size_t cells, double scale = 1)
+    {
+      if (points.empty()) return;
+      int x1 = points[0].x, y1 = points[0].y, x2 = x1, y2 = y1;
+      for (const auto& p : points) {
+        x1 = min(x1, p.x);
+        y1 = min(y1, p.y);
+        x2 = max(x2, p.x);
+        y2 = max(y2, p.y);
+      }
+      left = x1;
+      top = y1;
+      const double w = max(1, x2 - x1 + 1);
+      const double h = max(1, y2 - y1 + 1);
+      cell = max(1., scale * sqrt(w * h / max<size_t>(1, cells)));
+      columns = static_cast<int>(ceil(w / cell));
+      rows = static_cast<int>(ceil(h / cell));
+    }
+
+    int Column(double x) const { return clamp(static_cast<int>(floor((x - left) / cell)), 0, columns - 1); }
+    int Row(double y) const { return clamp(static_cast<int>(floor((y - top) / cell)), 0, rows - 1); }
+    size_t Count() const { return static_cast<size_t>(rows) * columns; }
+
+    int left = 0;
+    int top = 0;
+    double cell = 1;
+    int rows = 1;
+    int columns = 1;
+  };
+
+  //calls proc(cell) for every cell the segment passes, with a small margin
+  //so that cells of the segment points on cell borders are never missed
+  template<typename Proc>
+  void Cover(const Grid& grid, Point a, Point b, Proc proc)
+  {
+    const double margin = 0.5;
+    double x1 = a.x, y1 = a.y, x2 = b.x, y2 = b.y;
+    if (y2 < y1) {
+      swap(x1, x2);
+      swap(y1, y2);
+    }
+    const int r1 = grid.Row(y1 - margin);
+    const int r2 = grid.Row(y2 + margin);
+    for (int r = r1; r <= r2; ++r) {
+      const double top = max(y1, grid.top + r * grid.cell - margin);
+      const double bottom = min(y2, grid.top + (r + 1) * grid.cell + margin);
+      double xa = x1, xb = x2;
+      if (y2 > y1) {
+        xa = x1 + (x2 - x1) * (top - y1) / (y2 - y1);
+        xb = x1 + (x2 - x1) * (bottom - y1) / (y2 - y1);
+      }
+      const int c1 = grid.Column(min(xa, xb) - margin);
+      const int c2 = grid.Column(max(xa, xb) + margin);
+      for (int c = c1; c <= c2; ++c) proc(static_cast<size_t>(r) * grid.columns + c);
+    }
+  }
+
+  //items of every cell, counting sort by chunks keeps the item order
+  struct Bins {
+    vector<size_t> offsets;
+    vector<uint32_t> items;
+  };
+
+  template<typename CoverProc>
+  Bins Bin(size_t n, size_t cells, CoverProc cover)
+  {
+    const size_t chunks = Parallel::Threads();
+    vector<size_t> counts(cells * chunks, 0);
+    Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        cover(i, [&](size_t cell) { counts[cell * chunks + chunk]++; });
+      }
+      }, 1 << 12);
+    const size_t total = Parallel::PrefixSum(counts);
+
+    Bins b;
+    b.items.resize(total);
+    b.offsets.resize(cells + 1);
+    for (size_t cell = 0; cell < cells; ++cell) b.offsets[cell] = counts[cell * chunks];
+    b.offsets[cells] = total;
+    Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        cover(i, [&](size_t cell) { b.items[counts[cell * chunks + chunk]++] = static_cast<uint32_t>(i); });
+      }
+      }, 1 << 12);
+    return b;
+  }
+
+  long long Orientation(Point a, Point b, Point c)
+  {
+    return static_cast<long long>(b.x - a.x) * (c.y - a.y) - static_cast<long long>(b.y - a.y) * (c.x - a.x);
+  }
+
+  int Sign(long long x)
+  {
+    return (x > 0) - (x < 0);
+  }
+
+  //proper crossing, touching and collinear overlaps are not counted
+  bool Cross(const Segment& s, const Segment& t)
+  {
+    if (max(s.a.x, s.b.x) < min(t.a.x, t.b.x) || max(t.a.x, t.b.x) < min(s.a.x, s.b.x)
+      || max(s.a.y, s.b.y) < min(t.a.y, t.b.y) || max(t.a.y, t.b.y) < min(s.a.y, s.b.y)) return false;
+    return Sign(Orientation(s.a, s.b, t.a)) * Sign(Orientation(s.a, s.b, t.b)) < 0
+      && Sign(Orientation(t.a, t.b, s.a)) * Sign(Orientation(t.a, t.b, s.b)) < 0;
+  }
+
+  size_t Crossings(const Snapshot& s)
+  {
+    const auto& segments = s.segments;
+    if (segments.empty()) return 0;
+    //about a cell per edge, but not smaller than a quarter of the mean edge,
+    //so every edge is binned into a few cells only
+    vector<double> lengths(Parallel::Threads(), 0);
+    Parallel::ForChunks(0, segments.size(), [&](size_t chunk, size_t from, size_t to) {
+      double sum = 0;
+      for (size_t e = from; e < to; ++e) {
+        sum += hypot(segments[e].a.x - segments[e].b.x, segments[e].a.y - segments[e].b.y);
+      }
+      lengths[chunk] = sum;
+      });
+    double mean = 0;
+    for (double l : lengths) mean += l;
+    mean /= segments.size();
+    const Grid fine(s.points, segments.size());
+    const Grid grid(s.points, segments.size(), max(1., mean / 4 / fine.cell));
+    const Bins bins = Bin(segments.size(), grid.Count(), [&](size_t i, auto proc) {
+      Cover(grid, segments[i].a, segments[i].b, proc);
+      });
+
+    //a pair is counted only in the cell of its crossing point
+    vector<size_t> partial(Parallel::Threads(), 0);
+    Parallel::ForChunks(0, grid.Count(), [&](size_t chunk, size_t from, size_t to) {
+      size_t count = 0;
+      for (size_t cell = from; cell < to; ++cell) {
+        const size_t begin = bins.offsets[cell];
+        const size_t end = bins.offsets[cell + 1];
+        for (size_t i = begin; i < end; ++i) {
+          const Segment& p = segments[bins.items[i]];
+          for (size_t j = i + 1; j < end; ++j) {
+            const Segment& q = segments[bins.items[j]];
+            if (p.u == q.u || p.u == q.v || p.v == q.u || p.v == q.v) continue;
+            if (!Cross(p, q)) continue;
+            const double d = static_cast<double>(Orientation(q.a, q.b, p.a));
+            const double k = d / (d - Orientation(q.a, q.b, p.b));
+            const double x = p.a.x + k * (p.b.x - p.a.x);
+            const double y = p.a.y + k * (p.b.y - p.a.y);
+            if (static_cast<size_t>(grid.Row(y)) * grid.columns + grid.Column(x) == cell) count++;
+          }
+        }
+      }
+      partial[chunk] = count;
+      }, 64);
+
+    size_t total = 0;
+    for (size_t c : partial) total += c;
+    return total;
+  }
+
+  double Separation(const vector<Point>& points)
+  {
+    const size_t n = points.size();
+    if (n < 2) return 0;
+    //the closest pair lies in neighbouring cells if it's closer than the cell side,
+    //otherwise the grid is made coarser and the search repeated
+    for (double scale = 1; ; scale *= 2) {
+      const Grid grid(points, n, scale);
+      const Bins bins = Bin(n, grid.Count(), [&](size_t i, auto proc) {
+        proc(static_cast<size_t>(grid.Row(points[i].y)) * grid.columns + grid.Column(points[i].x));
+        });
+      vector<double> partial(Parallel::Threads(), numeric_limits<double>::infinity());
+      Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+        double best = partial[chunk];
+        for (size_t i = from; i < to; ++i) {
+          const int r = grid.Row(points[i].y);
+          const int c = grid.Column(points[i].x);
+          for (int nr = max(0, r - 1); nr <= min(grid.rows - 1, r + 1); ++nr) {
+            for (int nc = max(0, c - 1); nc <= min(grid.columns - 1, c + 1); ++nc) {
+              const size_t cell = static_cast<size_t>(nr) * grid.columns + nc;
+              for (size_t k = bins.offsets[cell]; k < bins.offsets[cell + 1]; ++k) {
+                const size_t j = bins.items[k];
+                if (j <= i) continue;
+                const double dx = points[i].x - points[j].x;
+                const double dy = points[i].y - points[j].y;
+                best = min(best, dx * dx + dy * dy);
+              }
+            }
+          }
+        }
+        partial[chunk] = best;
+        }, 1 << 12);
+      const double best = sqrt(*min_element(partial.begin(), partial.end()));
+      if (best <= grid.cell || grid.Count() == 1) return best;
+    }
+  }
+
+  double Utilisation(const vector<Point>& points)
+  {
+    if (points.empty()) return 0;
+    const Grid grid(points, points.size());
+    vector<atomic<bool>> occupied(grid.Count());
+    Parallel::For(0, points.size(), [&](size_t i) {
+      occupied[static_cast<size_t>(grid.Row(points[i].y)) * grid.columns + grid.Column(points[i].x)]
+        .store(true, memory_order_relaxed);
+      });
+    size_t count = 0;
+    for (const auto& o : occupied) count += o.load(memory_order_relaxed);
+    return count / static_cast<double>(occupied.size());
+  }
+
+}
+
+Paint::Metrics Paint::Measure(const Graph& graph)
+{
+  const Snapshot s = Take(graph);
+  Metrics m;
+  m.crossings = Crossings(s);
+  m.min_separation = Separation(s.points);
+  m.area_utilisation = Utilisation(s.points);
+
+  const size_t n = s.segments.size();
+  if (n > 0) {
+    vector<double> sums(Parallel::Threads(), 0);
+    vector<double> squares(Parallel::Threads(), 0);
+    Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+      double sum = 0, square = 0;
+      for (size_t e = from; e < to; ++e) {
+        const double l = hypot(s.segments[e].a.x - s.segments[e].b.x, s.segments[e].a.y - s.segments[e].b.y);
+        sum += l;
+        square += l * l;
+      }
+      sums[chunk] = sum;
+      squares[chunk] = square;
+      });
+    double sum = 0, square = 0;
+    for (size_t c = 0; c < sums.size(); ++c) {
+      sum += sums[c];
+      square += squares[c];
+    }
+    m.edge_length_mean = sum / n;
+    m.edge_length_variance = max(0., square / n - m.edge_length_mean * m.edge_length_mean);
+  }
+  return m;
+}
+
+size_t Paint::CountCrossings(const Graph& graph)
+{
+  return Crossings(Take(graph));
+}
+
+double Paint::MinSeparation(const Graph& graph)
+{
+  return Separation(Take(graph).points);
+}
+
+double Paint::AreaUtilisation(const Graph& graph)
+{
+  return Utilisation(Take(graph).points);
+}
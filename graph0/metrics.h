@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+#include "graph.h"
+
+namespace Paint {
+
+  //quality of a laid graph, distances are notional
+  struct Metrics {
+    //pairs of non-adjacent edges crossing each other
+    size_t crossings = 0;
+    //the smallest distance between two vertexes
+    double min_separation = 0;
+    double edge_length_mean = 0;
+    double edge_length_variance = 0;
+    //share of the drawing box cells with at least one vertex,
+    //the grid has about one cell per vertex, so 1 is a perfectly even spread
+    double area_utilisation = 0;
+  };
+
+  /* every metric is grid-accelerated and multithreaded:
+  crossings are tested only between edges passing the same cell */
+  Metrics Measure(const Graph& graph);
+
+  size_t CountCrossings(const Graph& graph);
+  double MinSeparation(const Graph& graph);
+  double AreaUtilisation(const Graph& graph);
+
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "overview.h"
+#include "pipeline.h"
+
+using namespace std;
+
+namespace {
+
+  uint64_t Key(u_int level, u_int node)
+  {
+    return static_cast<uint64_t>(level) << 32 | node;
+  }
+
+}
+
+Paint::Overview::Overview(shared_ptr<const Math::Hierarchy> h)
+  : hierarchy(move(h))
+{
+  if (!hierarchy) throw 0;
+  Lay(Frame{ hierarchy->Root(), 0 });
+  path.push_back(Frame{ hierarchy->Root(), 0 });
+}
+
+void Paint::Overview::Render(Painter& p) const
+{
+  const Graph& graph = Current();
+  const u_int level = path.back().level - 1;
+  const Math::CSRView vertexes = hierarchy->Adjacency(0);
+  u_int largest = 1;
+  for (const auto& [id, v] : graph.GetVertexes()) largest = max(largest, hierarchy->Size(level, id));
+
+  Scene& scene = p.GetScene();
+  scene.Reserve(graph.GetVertexes().size(), graph.GetEdges().size());
+  for (const auto& [id, v] : graph.GetVertexes()) {
+    //vertexes are labelled by their id, clusters by their size
+    const u_int size = hierarchy->Size(level, id);
+    scene.AddEllipse(Ellipse{ .center = v.p, .r = level == 0 ? 0 : Radius(size, largest) });
+    scene.AddLabel(static_cast<int>(level == 0 ? vertexes.ids[id] : size), v.p);
+  }
+  for (const auto& e : graph.GetEdges()) {
+    scene.AddLine(Line{ .from = graph.GetVertexes().at(e.from).p, .to = graph.GetVertexes().at(e.to).p });
+  }
+}
+
+optional<u_int> Paint::Overview::Pick(const Painter& p, int x, int y) const
+{
+  const Graph& graph = Current();
+  const u_int level = path.back().level - 1;
+  u_int largest = 1;
+  for (const auto& [id, v] : graph.GetVertexes()) largest = max(largest, hierarchy->Size(level, id));
+
+  const Point point = p.ToNotional(x, y);
+  const long long R = p.GetNotionalR();
+  optional<u_int> nearest;
+  long long best = 0;
+  for (const auto& [id, v] : graph.GetVertexes()) {
+    const long long dx = v.p.x - point.x;
+    const long long dy = v.p.y - point.y;
+    const long long r = R + (level == 0 ? 0 : Radius(hierarchy->Size(level, id), largest));
+    const long long d = dx * dx + dy * dy;
+    if (d <= r * r && (!nearest || d < best)) {
+      nearest = static_cast<u_int>(id);
+      best = d;
+    }
+  }
+  return nearest;
+}
+
+bool Paint::Overview::ZoomIn(u_int child)
+{
+  const u_int level = path.back().level - 1;
+  if (level == 0) return false;
+  if (hierarchy->Parent(level, child) != path.back().node) throw 0;
+  //the frame is shown only once it's laid
+  const Frame f{ level, child };
+  Lay(f);
+  path.push_back(f);
+  return true;
+}
+
+bool Paint::Overview::ZoomOut()
+{
+  if (path.size() == 1) return false;
+  path.pop_back();
+  return true;
+}
+
+void Paint::Overview::Lay(Frame f)
+{
+  if (laid.count(Key(f.level, f.node))) return;
+  const Math::CSR members = hierarchy->Members(f.level, f.node);
+  laid.emplace(Key(f.level, f.node), Math::DefaultPipeline().Lay(members.View()));
+}
+
+const Paint::Graph& Paint::Overview::Current() const
+{
+  return laid.at(Key(path.back().level, path.back().node));
+}
+
+int Paint::Overview::Radius(u_int size, u_int largest) const
+{
+  return static_cast<int>(Graph::AREA_SIZE * SUPERNODE_SHARE * sqrt(size / static_cast<double>(largest)));
+}
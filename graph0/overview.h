@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "graph.h"
+#include "hierarchy.h"
+
+namespace Paint {
+
+  /* drawing of the clustered graph: children of one hierarchy node are shown
+  as supernodes sized by their vertex count, joined by aggregated edges.
+  Members of a cluster are laid only when it's zoomed into,
+  the layouts are kept for going back and forth */
+  class Overview
+  {
+  public:
+    Overview(std::shared_ptr<const Math::Hierarchy> hierarchy);
+
+    void Render(Painter& p) const;
+    //child under the window point, it's index in the level below
+    std::optional<u_int> Pick(const Painter& p, int x, int y) const;
+
+    //shows the members of the child, false if it's a graph vertex
+    bool ZoomIn(u_int child);
+    //shows the parent cluster, false at the root
+    bool ZoomOut();
+
+  private:
+    struct Frame {
+      u_int level;
+      u_int node;
+    };
+
+    //lays the node at it's first visit, the path is left as it is if that throws
+    void Lay(Frame f);
+    const Graph& Current() const;
+    //extra radius of the supernode in notional coordinates
+    int Radius(u_int size, u_int largest) const;
+
+    //the largest supernode is this part of the area
+    static constexpr double SUPERNODE_SHARE = 1 / 40.;
+
+  private:
+    std::shared_ptr<const Math::Hierarchy> hierarchy;
+    //from the root to the shown node
+    std::vector<Frame> path;
+    //key is level << 32 | node
+    std::unordered_map<uint64_t, Graph> laid;
+  };
+
+}
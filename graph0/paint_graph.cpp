@@ -5,7 +5,7 @@
 
 using namespace std;
 
-Paint::Graph::Graph(const vector<Vertex>& vs, vector<Edge> edges)
+Paint::Graph::Graph(const vector<Vertex>& vs, Edges edges)
   : edges(move(edges))
 {
   for (const auto& v : vs) {
@@ -15,16 +15,19 @@ Paint::Graph::Graph(const vector<Vertex>& vs, vector<Edge> edges)
 
 void Paint::Graph::Render(Painter& p) const
 {
+  Render(p.GetScene());
+}
+
+void Paint::Graph::Render(Scene& scene) const
+{
+  scene.Reserve(vertexes.size(), edges.size());
   for (const auto& [id, vertex] : vertexes) {
-    p.AddObject(
-      Paint::Ellipse{ .center = vertex.p }
-    ).AddObject(
-      Paint::Text{ .text = to_string(id), .center = vertex.p }
-    );
+    scene.AddEllipse(Paint::Ellipse{ .center = vertex.p });
+    scene.AddLabel(id, vertex.p);
   }
 
   for (const auto& edge : edges) {
-    p.AddObject(
+    scene.AddLine(
       Paint::Line{ .from = vertexes.at(edge.from).p, .to = vertexes.at(edge.to).p }
     );
   }
@@ -223,6 +226,43 @@ void Paint::Graph::Rotate()
   }
 }
 
+void Paint::Graph::MoveVertex(int id, Point p)
+{
+  vertexes.at(id).p = p;
+}
+
+void Paint::Graph::AddVertex(Vertex v)
+{
+  if (!vertexes.emplace(v.id, v).second) throw 0;
+}
+
+void Paint::Graph::RemoveVertex(int id)
+{
+  if (vertexes.erase(id) == 0) throw 0;
+}
+
+size_t Paint::Graph::AddEdge(Edge e)
+{
+  edges.push_back(e);
+  return edges.size() - 1;
+}
+
+void Paint::Graph::RemoveEdge(size_t index)
+{
+  edges.at(index) = edges.back();
+  edges.pop_back();
+}
+
+const Paint::Vertexes& Paint::Graph::GetVertexes() const
+{
+  return vertexes;
+}
+
+const Paint::Edges& Paint::Graph::GetEdges() const
+{
+  return edges;
+}
+
 int Paint::Graph::GetArea() const
 {
   return areaW * areaH;
@@ -2,6 +2,7 @@
 #include "windows.h"
 #include "gdiplus.h"
 #include <cmath>
+#include <chrono>
 
 #include "painter.h"
 #include "doutput.h"
@@ -9,102 +10,368 @@
 
 using namespace std;
 
-void Paint::Painter::Draw(HDC hdc, int wndW, int wndH)
+Paint::Painter::~Painter()
+{
+  if (back_dc) {
+    SelectObject(back_dc, old_bitmap);
+    DeleteObject(back_bitmap);
+    DeleteDC(back_dc);
+  }
+}
+
+bool Paint::Painter::Draw(HDC hdc, int wndW, int wndH, const RECT* dirty)
 {
   using namespace Gdiplus;
-  Graphics graphics(hdc);
+  PrepareBuffer(hdc, wndW, wndH);
+  Graphics graphics(back_dc);
   graphics.SetSmoothingMode(SmoothingModeHighSpeed);
 
-  const SolidBrush bgBrush(settings.bg_color);
-  graphics.FillRectangle(&bgBrush, 0, 0, wndW, wndH);
+  //pending restart needs the whole window
+  const bool partial = !progress.restart && dirty && (dirty->left > 0 || dirty->top > 0
+    || dirty->right < wndW || dirty->bottom < wndH);
+  if (partial) {
+    DrawRegion(graphics, *dirty);
+    BitBlt(hdc, dirty->left, dirty->top, dirty->right - dirty->left,
+      dirty->bottom - dirty->top, back_dc, dirty->left, dirty->top, SRCCOPY);
+    return progress.complete;
+  }
 
-  if (settings.queue.size() > objects.size())
-    return;
-  Update(wndW, wndH);
+  if (progress.restart) {
+    const SolidBrush bgBrush(settings.bg_color);
+    graphics.FillRectangle(&bgBrush, 0, 0, wndW, wndH);
+    progress = Progress{ .restart = false, .frame = progress.frame };
+    Update(wndW, wndH);
+  }
+  if (!progress.complete) DrawSlice(graphics);
+  BitBlt(hdc, 0, 0, wndW, wndH, back_dc, 0, 0, SRCCOPY);
+  return progress.complete;
+}
 
-  for (auto layer : settings.queue) {
-    for (const auto& o : objects.at(layer)) {
+void Paint::Painter::PrepareBuffer(HDC hdc, int wndW, int wndH)
+{
+  if (back_dc && bufferW == wndW && bufferH == wndH) return;
+  if (back_dc) {
+    SelectObject(back_dc, old_bitmap);
+    DeleteObject(back_bitmap);
+    DeleteDC(back_dc);
+  }
+  back_dc = CreateCompatibleDC(hdc);
+  if (!back_dc) throw 0;
+  //DIB section, so labels can be written into the pixels directly
+  BITMAPINFO info{};
+  info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  info.bmiHeader.biWidth = max(1, wndW);
+  info.bmiHeader.biHeight = -max(1, wndH);
+  info.bmiHeader.biPlanes = 1;
+  info.bmiHeader.biBitCount = 32;
+  info.bmiHeader.biCompression = BI_RGB;
+  void* bits = nullptr;
+  back_bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+  if (!back_bitmap) throw 0;
+  back_bits = static_cast<uint32_t*>(bits);
+  old_bitmap = SelectObject(back_dc, back_bitmap);
+  bufferW = wndW;
+  bufferH = wndH;
+  progress.restart = true;
+}
 
-      if (layer == Paint::Layer::ELLIPSE) {
-        const auto& e = get<Paint::Ellipse>(o);
+void Paint::Painter::DrawSlice(Gdiplus::Graphics& graphics)
+{
+  if (scene.Empty()) {
+    progress.complete = true;
+    return;
+  }
+  const Tools tools(settings, map.R, map.edge_width);
+  const size_t stride = max<size_t>(1, scene.GetLines().size() / settings.coarse_lines);
+  //animation frames subsample vertexes too, so the coarse pass fits the slice
+  const size_t vertex_stride = progress.frame
+    ? max<size_t>(1, scene.GetEllipses().size() / settings.coarse_vertexes) : 1;
+  const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(settings.slice_ms);
+  const Surface surface = BackSurface(RECT{ 0, 0, bufferW, bufferH });
+  bool flushed = false;
 
-        Gdiplus::SolidBrush brush(settings.vertex_color);
-        graphics.FillEllipse(&brush,
-          static_cast<int>(scaleX * e.center.x) - R + paddingW,
-          static_cast<int>(scaleY * e.center.y) - R + paddingH,
-          2 * R, 2 * R);
-      }
-      else if (layer == Paint::Layer::LINE) {
-        const auto& l = get<Paint::Line>(o);
-
-        Gdiplus::Pen pen(settings.edge_color, edge_width);
-        graphics.DrawLine(&pen,
-          static_cast<int>(scaleX * l.from.x) + paddingW,
-          static_cast<int>(scaleY * l.from.y) + paddingH,
-          static_cast<int>(scaleX * l.to.x) + paddingW,
-          static_cast<int>(scaleY * l.to.y) + paddingH
-        );
+  size_t drawn = 0;
+  while (true) {
+    if (progress.layer == settings.queue.size()) {
+      if (progress.pass == 1) {
+        progress.complete = true;
+        return;
       }
-      else if (layer == Paint::Layer::TEXT) {
-        const auto& t = get<Paint::Text>(o);
-
-        const std::wstring buf = std::wstring(t.text.begin(), t.text.end());
-        const WCHAR*       label = buf.c_str();
-        const Font         font(settings.font, R);
-        const RectF        box(
-          static_cast<int>(scaleX * t.center.x) - R + paddingW,
-          static_cast<int>(scaleY * t.center.y) - R + paddingH,
-          2 * R, 2 * R);
-        SolidBrush         brush(settings.label_color);
-        StringFormat       format;
-        format.SetAlignment(StringAlignmentCenter);
-        format.SetLineAlignment(StringAlignmentCenter);
-        graphics.DrawString(label, buf.size(), &font, box, &format, &brush);
+      progress.pass = 1;
+      progress.layer = 0;
+      progress.index = 0;
+    }
+    const Layer layer = settings.queue[progress.layer];
+    //labels are left for the refining pass, vertexes are redrawn there
+    //only if edges were drawn over them or the coarse pass skipped some
+    const bool skip = (progress.pass == 0 && layer == Layer::TEXT)
+      || (progress.pass == 1 && layer == Layer::ELLIPSE && stride == 1 && vertex_stride == 1);
+    if (skip || progress.index >= Count(layer)) {
+      progress.layer++;
+      progress.index = 0;
+      continue;
+    }
+
+    const size_t i = progress.index++;
+    if (layer == Layer::LINE && (i % stride == 0) != (progress.pass == 0)) continue;
+    if (layer == Layer::ELLIPSE && (progress.pass == 0
+      ? i % vertex_stride != 0 : stride == 1 && i % vertex_stride == 0)) continue;
+    if (layer == Layer::TEXT) DrawLabel(graphics, tools, surface, i, flushed);
+    else {
+      DrawObject(graphics, tools, map, layer, i, wlabel);
+      flushed = false;
+    }
+    if (++drawn % 256 == 0 && chrono::steady_clock::now() > deadline) return;
+  }
+}
+
+void Paint::Painter::DrawRegion(Gdiplus::Graphics& graphics, const RECT& clip)
+{
+  using namespace Gdiplus;
+  graphics.SetClip(Rect(clip.left, clip.top, clip.right - clip.left, clip.bottom - clip.top));
+  const SolidBrush bgBrush(settings.bg_color);
+  graphics.FillRectangle(&bgBrush, clip.left, clip.top,
+    clip.right - clip.left, clip.bottom - clip.top);
+  if (scene.Empty()) return;
+
+  const Tools tools(settings, map.R, map.edge_width);
+  const Surface surface = BackSurface(clip);
+  bool flushed = false;
+  //only the objects the scene index finds near the clip are checked
+  const int margin = map.R + static_cast<int>(map.edge_width) + 1;
+  const Point lt = ToNotional(clip.left - margin, clip.top - margin);
+  const Point rb = ToNotional(clip.right + margin, clip.bottom + margin);
+  vector<size_t> found[3];
+  scene.Find(Point{ lt.x - 1, lt.y - 1 }, Point{ rb.x + 1, rb.y + 1 },
+    found[static_cast<int>(Layer::ELLIPSE)], found[static_cast<int>(Layer::LINE)],
+    found[static_cast<int>(Layer::TEXT)]);
+  for (auto layer : settings.queue) {
+    for (size_t i : found[static_cast<int>(layer)]) {
+      if (!Touches(map, clip, layer, i)) continue;
+      if (layer == Layer::TEXT) DrawLabel(graphics, tools, surface, i, flushed);
+      else {
+        DrawObject(graphics, tools, map, layer, i, wlabel);
+        flushed = false;
       }
-      else throw 0;
+    }
+  }
+  graphics.ResetClip();
+}
+
+Paint::Surface Paint::Painter::BackSurface(const RECT& clip) const
+{
+  return Surface{
+    .pixels = back_bits,
+    .width = bufferW,
+    .height = bufferH,
+    .stride = bufferW,
+    .clip = clip
+  };
+}
 
+void Paint::Painter::DrawLabel(Gdiplus::Graphics& graphics, const Tools& tools, const Surface& surface,
+  size_t i, bool& flushed)
+{
+  if (glyphs && surface.pixels) {
+    if (!flushed) {
+      graphics.Flush(Gdiplus::FlushIntentionSync);
+      GdiFlush();
+      flushed = true;
     }
+    if (BlendLabel(surface, *glyphs, map, i)) return;
+  }
+  DrawObject(graphics, tools, map, Layer::TEXT, i, wlabel);
+  flushed = false;
+}
+
+bool Paint::Painter::BlendLabel(const Surface& surface, const GlyphAtlas& glyphs, const Mapping& m, size_t i) const
+{
+  const auto& t = scene.GetLabels()[i];
+  const auto text = scene.GetText(t);
+  if (!glyphs.Covers(text)) return false;
+  glyphs.Draw(surface, text, m.X(t.center.x), m.Y(t.center.y));
+  return true;
+}
+
+bool Paint::Painter::Touches(const Mapping& m, const RECT& clip, Layer layer, size_t i) const
+{
+  //window box of the object with the margin for vertex radius and pen
+  const int margin = m.R + static_cast<int>(m.edge_width) + 1;
+  auto touches = [&](Point p1, Point p2, int extra = 0) {
+    const int x1 = m.X(p1.x);
+    const int y1 = m.Y(p1.y);
+    const int x2 = m.X(p2.x);
+    const int y2 = m.Y(p2.y);
+    const int e = margin + extra;
+    return min(x1, x2) - e < clip.right && clip.left < max(x1, x2) + e
+      && min(y1, y2) - e < clip.bottom && clip.top < max(y1, y2) + e;
+  };
+  switch (layer) {
+  case Layer::ELLIPSE: {
+    const auto& e = scene.GetEllipses()[i];
+    return touches(e.center, e.center, m.Length(e.r));
+  }
+  case Layer::LINE: {
+    const auto& l = scene.GetLines()[i];
+    return touches(l.from, l.to);
+  }
+  case Layer::TEXT: {
+    const auto& t = scene.GetLabels()[i];
+    return touches(t.center, t.center);
+  }
   }
+  throw 0;
+}
+
+void Paint::Painter::DrawObject(Gdiplus::Graphics& graphics, const Tools& tools, const Mapping& m,
+  Layer layer, size_t i, std::wstring& buffer) const
+{
+  using namespace Gdiplus;
+  const int R = m.R;
+  if (layer == Paint::Layer::ELLIPSE) {
+    const auto& e = scene.GetEllipses()[i];
+    const int r = R + m.Length(e.r);
+    graphics.FillEllipse(&tools.vertex, m.X(e.center.x) - r, m.Y(e.center.y) - r, 2 * r, 2 * r);
+  }
+  else if (layer == Paint::Layer::LINE) {
+    const auto& l = scene.GetLines()[i];
+    graphics.DrawLine(&tools.edge, m.X(l.from.x), m.Y(l.from.y), m.X(l.to.x), m.Y(l.to.y));
+  }
+  else if (layer == Paint::Layer::TEXT) {
+    const auto& t = scene.GetLabels()[i];
+    const auto text = scene.GetText(t);
+    buffer.assign(text.begin(), text.end());
+    const RectF box(m.X(t.center.x) - R, m.Y(t.center.y) - R, 2 * R, 2 * R);
+    graphics.DrawString(buffer.c_str(), buffer.size(), &tools.font, box, &tools.format, &tools.label);
+  }
+  else throw 0;
+}
+
+size_t Paint::Painter::Count(Layer layer) const
+{
+  switch (layer) {
+  case Layer::LINE: return scene.GetLines().size();
+  case Layer::ELLIPSE: return scene.GetEllipses().size();
+  case Layer::TEXT: return scene.GetLabels().size();
+  }
+  throw 0;
 }
 
 void Paint::Painter::Update(int wndW, int wndH)
 {
-  paddingW = static_cast<int>(wndW * settings.paddingW);
-  paddingH = static_cast<int>(wndH * settings.paddingH);
-  double w = wndW - 2 * paddingW;
-  double h = wndH - 2 * paddingH;
-  scaleX = w / static_cast<double>(Paint::Graph::AREA_SIZE);
-  scaleY = h / static_cast<double>(Paint::Graph::AREA_SIZE);
+  map = MapTo(wndW, wndH);
+  //the atlas is rasterized once per font size
+  if (map.R > 0 && (!glyphs || glyphs->Size() != map.R)) {
+    glyphs = make_unique<GlyphAtlas>(settings.font, map.R, settings.label_color);
+  }
+}
+
+Paint::Painter::Mapping Paint::Painter::MapTo(int wndW, int wndH) const
+{
+  Mapping m;
+  m.paddingW = static_cast<int>(wndW * settings.paddingW);
+  m.paddingH = static_cast<int>(wndH * settings.paddingH);
+  double w = wndW - 2 * m.paddingW;
+  double h = wndH - 2 * m.paddingH;
+  m.scaleX = w / static_cast<double>(Paint::Graph::AREA_SIZE);
+  m.scaleY = h / static_cast<double>(Paint::Graph::AREA_SIZE);
 
-  R = settings.vertex_r + static_cast<int>(
-    pow(wndW * wndH / 300 / (1 + 0.3 * objects[Paint::Layer::ELLIPSE].size()), 0.45)
+  //64-bit area, images can be much bigger than the window
+  const long long area = static_cast<long long>(wndW) * wndH;
+  m.R = settings.vertex_r + static_cast<int>(
+    pow(area / 300 / (1 + 0.3 * scene.GetEllipses().size()), 0.45)
     );
-  edge_width = 2. + pow(wndW * wndH / 10000, 0.3) -
-    min(2., log(objects[Paint::Layer::ELLIPSE].size()));
+  m.edge_width = 2. + pow(area / 10000, 0.3) -
+    min(2., log(scene.GetEllipses().size()));
+  return m;
 }
 
 void Paint::Painter::Reset()
 {
-  objects.clear();
-  scaleX = scaleY = edge_width = 0;
-  paddingW = paddingH = R = 0;
+  scene.Clear();
+  progress.restart = true;
+  progress.frame = false;
+  map = Mapping{};
+}
+
+void Paint::Painter::Invalidate(bool frame)
+{
+  progress.restart = true;
+  progress.frame = frame;
 }
 
 Paint::Painter& Paint::Painter::AddObject(Object o)
 {
   if (holds_alternative<Paint::Ellipse>(o)) {
-    objects[Paint::Layer::ELLIPSE].push_back(move(o));
+    scene.AddEllipse(get<Paint::Ellipse>(o));
   }
   else if (holds_alternative<Paint::Line>(o)) {
-    objects[Paint::Layer::LINE].push_back(move(o));
+    scene.AddLine(get<Paint::Line>(o));
   }
   else if (holds_alternative<Paint::Text>(o)) {
-    objects[Paint::Layer::TEXT].push_back(move(o));
+    const auto& t = get<Paint::Text>(o);
+    scene.AddLabel(t.text, t.center);
   }
   else throw 0;
   return *this;
 }
 
+Paint::Painter& Paint::Painter::SetObject(size_t index, Object o)
+{
+  if (holds_alternative<Paint::Ellipse>(o)) {
+    scene.SetEllipse(index, get<Paint::Ellipse>(o));
+  }
+  else if (holds_alternative<Paint::Line>(o)) {
+    scene.SetLine(index, get<Paint::Line>(o));
+  }
+  else if (holds_alternative<Paint::Text>(o)) {
+    const auto& t = get<Paint::Text>(o);
+    scene.SetLabel(index, t.text, t.center);
+  }
+  else throw 0;
+  return *this;
+}
+
+Paint::Scene& Paint::Painter::GetScene()
+{
+  return scene;
+}
+
+Paint::Point Paint::Painter::ToNotional(int x, int y) const
+{
+  if (map.scaleX == 0 || map.scaleY == 0) return Point{};
+  return Point{
+    static_cast<int>((x - map.paddingW) / map.scaleX),
+    static_cast<int>((y - map.paddingH) / map.scaleY)
+  };
+}
+
+RECT Paint::Painter::ToWindow(Point lt, Point rb) const
+{
+  const int margin = map.R + static_cast<int>(map.edge_width) + 1;
+  return RECT{
+    map.X(lt.x) - margin,
+    map.Y(lt.y) - margin,
+    map.X(rb.x) + margin + 1,
+    map.Y(rb.y) + margin + 1
+  };
+}
+
+int Paint::Painter::GetNotionalR() const
+{
+  return map.scaleX == 0 ? 0 : static_cast<int>(map.R / min(map.scaleX, map.scaleY)) + 1;
+}
+
+Paint::Painter::Tools::Tools(const Settings& settings, int R, double edge_width)
+  : vertex(settings.vertex_color),
+    edge(settings.edge_color, edge_width),
+    font(settings.font, R),
+    label(settings.label_color)
+{
+  format.SetAlignment(Gdiplus::StringAlignmentCenter);
+  format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
+}
+
 Paint::Painter::Settings::Settings()
   : vertex_color(255, 0, 71, 109),
     edge_color(255, 165, 52, 0),
@@ -7,31 +7,12 @@
 #include <vector>
 #include <variant>
 #include <deque>
+#include <memory>
 
-namespace Paint {
-
-  /* the coordinates of the following structures are notional,
-  that is, they are the coordinates of the
-  notional window 1000x1000 */
+#include "scene.h"
+#include "glyph_atlas.h"
 
-  struct Point {
-    int x = 0;
-    int y = 0;
-  };
-
-  struct Ellipse {
-    Point center;
-  };
-
-  struct Line{
-    Point from;
-    Point to;
-  };
-
-  struct Text {
-    std::string text;
-    Point center;
-  };
+namespace Paint {
 
   using Object = std::variant<Ellipse, Line, Text>;
 
@@ -43,12 +24,37 @@ namespace Paint {
   class Painter
   {
   public:
-    void Draw(HDC hdc, int wndW, int wndH);
+    Painter() = default;
+    Painter(const Painter&) = delete;
+    Painter& operator=(const Painter&) = delete;
+    ~Painter();
+
+    /* draws the scene progressively into the back buffer: every call draws
+    the next time slice and shows the buffer, the coarse pass (subsampled
+    edges, no labels) goes first. Returns false until the scene is complete.
+    Dirty rect smaller than the window is redrawn entirely */
+    bool Draw(HDC hdc, int wndW, int wndH, const RECT* dirty = nullptr);
     void Update(int wndW, int wndH);
     void Reset();
+    //scene was changed in place, the picture is drawn again;
+    //animation frames subsample vertexes in the coarse pass as well as edges
+    void Invalidate(bool frame = false);
 
     Painter& AddObject(Object o);
+    //replaces index-th object of the same layer
+    Painter& SetObject(size_t index, Object o);
+
+    //objects can be added to the scene directly, without variants
+    Scene& GetScene();
+
+    //window coordinates -> notional coordinates
+    Point ToNotional(int x, int y) const;
+    //window rect covering notional box with objects in it
+    RECT ToWindow(Point lt, Point rb) const;
+    //vertex radius in notional coordinates
+    int GetNotionalR() const;
   private:
+    friend class TileRenderer;
 
     struct Settings {
       Settings();
@@ -62,17 +68,86 @@ namespace Paint {
       Gdiplus::Color bg_color;
       int vertex_r = 4;
       const WCHAR* font = L"Arial";
+      //time budget of one progressive slice
+      int slice_ms = 8;
+      //the coarse pass draws about this count of edges,
+      //and of vertexes in animation frames
+      size_t coarse_lines = 20000;
+      size_t coarse_vertexes = 20000;
     };
     const Settings settings;
 
+    //drawing tools are made once per slice
+    struct Tools {
+      Tools(const Settings& settings, int R, double edge_width);
+
+      Gdiplus::SolidBrush vertex;
+      Gdiplus::Pen edge;
+      Gdiplus::Font font;
+      Gdiplus::SolidBrush label;
+      Gdiplus::StringFormat format;
+    };
+
+    struct Progress {
+      bool restart = true;
+      bool frame = false;
+      bool complete = false;
+      //0 - coarse pass, 1 - refining pass
+      int pass = 0;
+      //index in settings.queue and index of the next object in that layer
+      size_t layer = 0;
+      size_t index = 0;
+    };
+
+    void PrepareBuffer(HDC hdc, int wndW, int wndH);
+    void DrawSlice(Gdiplus::Graphics& graphics);
+    void DrawRegion(Gdiplus::Graphics& graphics, const RECT& clip);
+    //back buffer pixels limited by the clip
+    Surface BackSurface(const RECT& clip) const;
+    //GDI+ drawing is flushed before the label pixels are written
+    void DrawLabel(Gdiplus::Graphics& graphics, const Tools& tools, const Surface& surface,
+      size_t i, bool& flushed);
+    //notional -> pixel coordinates for the given picture size
+    struct Mapping {
+      double scaleX = 0;
+      double scaleY = 0;
+      int paddingW = 0;
+      int paddingH = 0;
+      int R = 0;
+      double edge_width = 0;
+
+      int X(int x) const { return static_cast<int>(scaleX * x) + paddingW; }
+      int Y(int y) const { return static_cast<int>(scaleY * y) + paddingH; }
+      //notional length -> pixels
+      int Length(int r) const { return static_cast<int>((scaleX < scaleY ? scaleX : scaleY) * r); }
+    };
+    Mapping MapTo(int wndW, int wndH) const;
+
+    //whether the object with its vertex radius and pen width touches the clip rect
+    bool Touches(const Mapping& m, const RECT& clip, Layer layer, size_t i) const;
+    void DrawObject(Gdiplus::Graphics& graphics, const Tools& tools, const Mapping& m,
+      Layer layer, size_t i, std::wstring& buffer) const;
+    //blends the label from the atlas, false if it has characters out of the atlas
+    bool BlendLabel(const Surface& surface, const GlyphAtlas& glyphs, const Mapping& m, size_t i) const;
+    size_t Count(Layer layer) const;
+
   private:
-    std::map<Layer, std::vector<Object>> objects;
-    double scaleX = 0;
-    double scaleY = 0;
-    int paddingW = 0;
-    int paddingH = 0;
-    int R = 0;
-    double edge_width = 0;
+    Scene scene;
+    //label conversion buffer, reused between labels
+    std::wstring wlabel;
+    //digits of the current vertex radius
+    std::unique_ptr<GlyphAtlas> glyphs;
+
+    //back buffer keeps the picture between slices
+    HDC back_dc = nullptr;
+    HBITMAP back_bitmap = nullptr;
+    HGDIOBJ old_bitmap = nullptr;
+    //top-down DIB section rows
+    uint32_t* back_bits = nullptr;
+    int bufferW = 0;
+    int bufferH = 0;
+    Progress progress;
+    Mapping map;
   };
 
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <exception>
+
+namespace Parallel {
+
+  //count of worker threads, at least 1
+  inline unsigned Threads()
+  {
+    const unsigned hc = std::thread::hardware_concurrency();
+    return hc == 0 ? 1 : hc;
+  }
+
+  //calls proc(chunk, from, to) for Threads() chunks of [begin; end),
+  //small ranges are processed in the calling thread.
+  //An exception of a chunk is rethrown in the calling thread after all the chunks end
+  template<typename Proc>
+  void ForChunks(size_t begin, size_t end, Proc proc, size_t grain = 1 << 14)
+  {
+    const size_t n = end > begin ? end - begin : 0;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(Threads(), n / grain));
+    if (chunks == 1) {
+      proc(0, begin, end);
+      return;
+    }
+    std::vector<std::exception_ptr> errors(chunks);
+    auto run = [&proc, &errors](size_t c, size_t from, size_t to) {
+      try {
+        proc(c, from, to);
+      }
+      catch (...) {
+        errors[c] = std::current_exception();
+      }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    try {
+      for (size_t c = 1; c < chunks; ++c) {
+        workers.emplace_back(run, c, begin + n * c / chunks, begin + n * (c + 1) / chunks);
+      }
+    }
+    catch (...) {
+      //the thread couldn't be started, the started ones are waited for
+      for (auto& w : workers) w.join();
+      throw;
+    }
+    run(0, begin, begin + n / chunks);
+    for (auto& w : workers) w.join();
+    for (const auto& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  }
+
+  //calls proc(i) for every i in [begin; end)
+  template<typename Proc>
+  void For(size_t begin, size_t end, Proc proc, size_t grain = 1 << 14)
+  {
+    ForChunks(begin, end, [&proc](size_t, size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) proc(i);
+      }, grain);
+  }
+
+  //exclusive prefix sum in place, returns total sum
+  template<typename T, typename Allocator>
+  T PrefixSum(std::vector<T, Allocator>& a)
+  {
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(Threads(), a.size() / (1 << 16)));
+    std::vector<T> sums(chunks + 1, 0);
+    auto bounds = [&a, chunks](size_t c) { return a.size() * c / chunks; };
+
+    //sums of chunks, then their own prefix sum, then local sums with chunk offset
+    ForChunks(0, chunks, [&](size_t, size_t from, size_t to) {
+      for (size_t c = from; c < to; ++c) {
+        T s = 0;
+        for (size_t i = bounds(c); i < bounds(c + 1); ++i) s += a[i];
+        sums[c + 1] = s;
+      }
+      }, 1);
+    for (size_t c = 0; c < chunks; ++c) sums[c + 1] += sums[c];
+    ForChunks(0, chunks, [&](size_t, size_t from, size_t to) {
+      for (size_t c = from; c < to; ++c) {
+        T s = sums[c];
+        for (size_t i = bounds(c); i < bounds(c + 1); ++i) {
+          const T x = a[i];
+          a[i] = s;
+          s += x;
+        }
+      }
+      }, 1);
+    return sums[chunks];
+  }
+
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <utility>
+
+#include "graph.h"
+#include "components.h"
+
+namespace Math {
+
+  /* layout pipeline with stages as template parameters:
+    Splitter(CSRView)  - Count() and Slice(c) of the parts laid separately
+    Strategy           - Paint::Graph operator()(CSRView part) const
+    Packer             - Paint::Graph operator()(vector<Paint::Graph>&& parts, u_int total) const
+    Renderer           - void operator()(const Paint::Graph& graph, Paint::Painter& p) const
+  every stage works on CSR slices of one adjacency, nothing is copied per part */
+  template<typename Splitter, typename Strategy, typename Packer, typename Renderer>
+  class LayoutPipeline
+  {
+  public:
+    LayoutPipeline(Strategy strategy = {}, Packer packer = {}, Renderer renderer = {})
+      : strategy(std::move(strategy)), packer(std::move(packer)), renderer(std::move(renderer))
+    {
+    }
+
+    Paint::Graph Lay(CSRView graph) const
+    {
+      return Lay(Splitter(graph), graph.size);
+    }
+
+    //the parts of the graph are already split, total is the count of it's vertexes
+    Paint::Graph Lay(const Splitter& splitter, u_int total) const
+    {
+      vector<Paint::Graph> parts;
+      parts.reserve(splitter.Count());
+      for (u_int c = 0; c < splitter.Count(); ++c) {
+        parts.push_back(strategy(splitter.Slice(c)));
+      }
+      return packer(std::move(parts), total);
+    }
+
+    //lays the graph and puts it into the painter
+    Paint::Graph Draw(CSRView graph, Paint::Painter& p) const
+    {
+      Paint::Graph result = Lay(graph);
+      renderer(result, p);
+      return result;
+    }
+
+  private:
+    Strategy strategy;
+    Packer packer;
+    Renderer renderer;
+  };
+
+  namespace Policy {
+
+    //all vertexes on the circle
+    struct Circle {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return ConnectedGraph::LayCircle(part);
+      }
+    };
+
+    //radial layout around the center, the part must be a tree
+    struct Radial {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return Tree::LayRadial(part);
+      }
+    };
+
+    //levels on horizontal lines, the part must be a tree
+    struct Tidy {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return Tree::LayTidy(part);
+      }
+    };
+
+    template<u_int Pivots = 50, bool Refine = true>
+    struct PivotMDS {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return ConnectedGraph::LayPivotMDS(part, Pivots, Refine);
+      }
+    };
+
+    template<bool Refine = false>
+    struct Spectral {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return ConnectedGraph::LaySpectral(part, Refine);
+      }
+    };
+
+    //almost-trees along their block-cut tree, the rest as the strategy says
+    template<Strategy S = Strategy::AUTO>
+    struct Cyclic {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return ConnectedGraph::Lay(part, S);
+      }
+    };
+
+    //trees and cyclic parts get their own strategies
+    template<typename TreeStrategy, typename CyclicStrategy>
+    struct Mixed {
+      Paint::Graph operator()(CSRView part) const
+      {
+        if (part.Arcs() / 2 + 1 == part.size) return tree(part);
+        return cyclic(part);
+      }
+
+      TreeStrategy tree;
+      CyclicStrategy cyclic;
+    };
+
+    //small parts and big parts get their own strategies
+    template<u_int Threshold, typename SmallStrategy, typename BigStrategy>
+    struct BySize {
+      Paint::Graph operator()(CSRView part) const
+      {
+        if (part.size < Threshold) return small(part);
+        return big(part);
+      }
+
+      SmallStrategy small;
+      BigStrategy big;
+    };
+
+    //the strategy chosen at run time through the object model
+    struct Dynamic {
+      Paint::Graph operator()(CSRView part) const
+      {
+        return Graph::LayComponent(part, strategy, tree_strategy);
+      }
+
+      Strategy strategy = Strategy::AUTO;
+      TreeStrategy tree_strategy = TreeStrategy::RADIAL;
+    };
+
+    //parts scaled by their vertex count and packed by Paint::Graph::Join
+    struct Join {
+      Paint::Graph operator()(vector<Paint::Graph>&& parts, u_int total) const
+      {
+        if (parts.empty()) return Paint::Graph({}, {});
+        for (auto& part : parts) {
+          part.Scale(sqrt(part.GetVertexes().size() / static_cast<double>(total)));
+        }
+        return std::move(Paint::Graph::Join(std::move(parts)));
+      }
+    };
+
+    struct Scene {
+      void operator()(const Paint::Graph& graph, Paint::Painter& p) const
+      {
+        graph.Render(p);
+      }
+    };
+
+  }
+
+  //radial trees and automatic strategy for the rest, chosen at compile time
+  using DefaultPipeline = LayoutPipeline<Components, Policy::Mixed<Policy::Radial, Policy::Cyclic<>>,
+    Policy::Join, Policy::Scene>;
+  //the pipeline Math::Graph::Lay() runs, strategies are chosen at run time
+  using DynamicPipeline = LayoutPipeline<Components, Policy::Dynamic, Policy::Join, Policy::Scene>;
+
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "quadtree.h"
+
+using namespace std;
+
+Paint::QuadTree::QuadTree(int size)
+{
+  nodes.push_back(Node{ .left = 0, .top = 0, .right = size + 1, .bottom = size + 1 });
+}
+
+void Paint::QuadTree::Insert(int id, Point p)
+{
+  int depth = 0;
+  const int leaf = Leaf(p, &depth);
+  nodes[leaf].items.push_back(Item{ .id = id, .p = p });
+  if (nodes[leaf].children == -1 && nodes[leaf].items.size() > CAPACITY
+    && depth < MAX_DEPTH && nodes[leaf].right - nodes[leaf].left > 1) {
+    Subdivide(leaf, depth);
+  }
+}
+
+void Paint::QuadTree::Remove(int id, Point p)
+{
+  auto& items = nodes[Leaf(p)].items;
+  auto it = find_if(items.begin(), items.end(),
+    [id](const Item& item) { return item.id == id; });
+  if (it == items.end()) throw 0;
+  *it = items.back();
+  items.pop_back();
+}
+
+void Paint::QuadTree::Move(int id, Point from, Point to)
+{
+  const int leaf = Leaf(from);
+  //fast path: the point stays in the same leaf
+  if (leaf == Leaf(to)) {
+    for (auto& item : nodes[leaf].items) {
+      if (item.id == id) {
+        item.p = to;
+        return;
+      }
+    }
+    throw 0;
+  }
+  Remove(id, from);
+  Insert(id, to);
+}
+
+optional<int> Paint::QuadTree::Nearest(Point p, int radius) const
+{
+  optional<int> result;
+  long long best = static_cast<long long>(radius) * radius;
+  vector<int> stack = { 0 };
+  while (!stack.empty()) {
+    const Node& node = nodes[stack.back()];
+    stack.pop_back();
+    //distance from the point to the node box
+    const long long dx = max(0, max(node.left - p.x, p.x - node.right + 1));
+    const long long dy = max(0, max(node.top - p.y, p.y - node.bottom + 1));
+    if (dx * dx + dy * dy > best) continue;
+
+    for (const auto& item : node.items) {
+      const long long ix = item.p.x - p.x;
+      const long long iy = item.p.y - p.y;
+      if (ix * ix + iy * iy <= best) {
+        best = ix * ix + iy * iy;
+        result = item.id;
+      }
+    }
+    if (node.children != -1) {
+      for (int c = 0; c < 4; ++c) {
+        stack.push_back(node.children + c);
+      }
+    }
+  }
+  return result;
+}
+
+void Paint::QuadTree::Find(Point lt, Point rb, vector<int>& ids) const
+{
+  vector<int> stack = { 0 };
+  while (!stack.empty()) {
+    const int n = stack.back();
+    const Node& node = nodes[n];
+    stack.pop_back();
+    //the root keeps the points out of the area, it's searched anyway
+    if (n != 0 && (node.right <= lt.x || rb.x < node.left || node.bottom <= lt.y || rb.y < node.top)) continue;
+
+    for (const auto& item : node.items) {
+      if (lt.x <= item.p.x && item.p.x <= rb.x && lt.y <= item.p.y && item.p.y <= rb.y) {
+        ids.push_back(item.id);
+      }
+    }
+    if (node.children != -1) {
+      for (int c = 0; c < 4; ++c) {
+        stack.push_back(node.children + c);
+      }
+    }
+  }
+}
+
+bool Paint::QuadTree::Node::Contains(Point p) const
+{
+  return left <= p.x && p.x < right && top <= p.y && p.y < bottom;
+}
+
+void Paint::QuadTree::Subdivide(int node, int depth)
+{
+  const int first = nodes.size();
+  const Node parent = nodes[node];
+  const int midX = (parent.left + parent.right) / 2;
+  const int midY = (parent.top + parent.bottom) / 2;
+  nodes.push_back(Node{ .left = parent.left, .top = parent.top, .right = midX, .bottom = midY });
+  nodes.push_back(Node{ .left = midX, .top = parent.top, .right = parent.right, .bottom = midY });
+  nodes.push_back(Node{ .left = parent.left, .top = midY, .right = midX, .bottom = parent.bottom });
+  nodes.push_back(Node{ .left = midX, .top = midY, .right = parent.right, .bottom = parent.bottom });
+  nodes[node].children = first;
+
+  //items out of the children boxes stay in the parent
+  vector<Item> kept;
+  for (const auto& item : parent.items) {
+    int c = 0;
+    while (c < 4 && !nodes[first + c].Contains(item.p)) c++;
+    if (c < 4) nodes[first + c].items.push_back(item);
+    else kept.push_back(item);
+  }
+  nodes[node].items = move(kept);
+
+  for (int c = 0; c < 4; ++c) {
+    if (nodes[first + c].items.size() > CAPACITY && depth + 1 < MAX_DEPTH
+      && nodes[first + c].right - nodes[first + c].left > 1) {
+      Subdivide(first + c, depth + 1);
+    }
+  }
+}
+
+int Paint::QuadTree::Leaf(Point p, int* depth) const
+{
+  int node = 0;
+  int d = 0;
+  while (nodes[node].children != -1) {
+    int c = 0;
+    while (c < 4 && !nodes[nodes[node].children + c].Contains(p)) c++;
+    if (c == 4) break;
+    node = nodes[node].children + c;
+    d++;
+  }
+  if (depth) *depth = d;
+  return node;
+}
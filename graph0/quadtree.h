@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <optional>
+
+#include "scene.h"
+
+namespace Paint {
+
+  /* spatial index of vertexes in notional coordinates,
+  supports incremental moving of a single point */
+  class QuadTree
+  {
+  public:
+    QuadTree(int size);
+
+    void Insert(int id, Point p);
+    void Remove(int id, Point p);
+    void Move(int id, Point from, Point to);
+
+    //the nearest point within the radius
+    std::optional<int> Nearest(Point p, int radius) const;
+    //appends the points of the box [lt; rb] to ids
+    void Find(Point lt, Point rb, std::vector<int>& ids) const;
+
+  private:
+    struct Item {
+      int id;
+      Point p;
+    };
+
+    struct Node {
+      int left;
+      int top;
+      int right;
+      int bottom;
+      //index of the first of 4 children, or -1 for leaf
+      int children = -1;
+      std::vector<Item> items;
+
+      bool Contains(Point p) const;
+    };
+
+    void Subdivide(int node, int depth);
+    int Leaf(Point p, int* depth = nullptr) const;
+
+    static const int CAPACITY = 16;
+    static const int MAX_DEPTH = 16;
+
+  private:
+    std::vector<Node> nodes;
+  };
+
+}
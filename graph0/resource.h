@@ -14,6 +14,8 @@
 #define IDR_MAINFRAME                   128
 #define ID_FILE                         32771
 #define ID_FILE_STARTDRAWINGTHEGRAPH    32772
+#define ID_FILE_NEXTGRAPH               32773
+#define ID_FILE_PREVIOUSGRAPH           32774
 #define IDC_STATIC                      -1
 
 // Next default values for new objects
@@ -22,7 +24,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
 #define _APS_NEXT_RESOURCE_VALUE        129
-#define _APS_NEXT_COMMAND_VALUE         32773
+#define _APS_NEXT_COMMAND_VALUE         32775
 #define _APS_NEXT_CONTROL_VALUE         1000
 #define _APS_NEXT_SYMED_VALUE           110
 #endif
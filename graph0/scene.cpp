@@ -0,0 +1,280 @@
+#include <charconv>
+#include <cstring>
+#include <numeric>
+
+#include "scene.h"
+#include "scene_index.h"
+
+using namespace std;
+
+namespace {
+
+  //FNV-1a
+  size_t Hash(string_view s)
+  {
+    size_t h = 14695981039346656037ull;
+    for (char c : s) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+}
+
+/* Paint::StringPool */
+
+Paint::StringPool::StringPool(const StringPool& other)
+{
+  *this = other;
+}
+
+Paint::StringPool& Paint::StringPool::operator=(const StringPool& other)
+{
+  if (this == &other) return *this;
+  Clear();
+  size_t size = 0;
+  for (auto s : other.strings) size += s.size();
+  if (blocks.empty() || block_sizes[0] < size) {
+    blocks.clear();
+    block_sizes.clear();
+    blocks.emplace_back(max(BLOCK_SIZE, size));
+    block_sizes.push_back(max(BLOCK_SIZE, size));
+  }
+  //the same order gives the same ids, the table is copied as is
+  strings.reserve(other.strings.size());
+  for (auto s : other.strings) {
+    char* data = Allocate(s.size());
+    if (!s.empty()) memcpy(data, s.data(), s.size());
+    strings.emplace_back(data, s.size());
+  }
+  slots = other.slots;
+  return *this;
+}
+
+unsigned Paint::StringPool::Intern(string_view s)
+{
+  if (2 * (strings.size() + 1) > slots.size()) {
+    Rehash(slots.empty() ? 1024 : 2 * slots.size());
+  }
+  const size_t mask = slots.size() - 1;
+  size_t slot = Hash(s) & mask;
+  while (slots[slot] != 0) {
+    if (strings[slots[slot] - 1] == s) return slots[slot] - 1;
+    slot = (slot + 1) & mask;
+  }
+
+  char* data = Allocate(s.size());
+  if (!s.empty()) memcpy(data, s.data(), s.size());
+  strings.emplace_back(data, s.size());
+  slots[slot] = static_cast<unsigned>(strings.size());
+  return static_cast<unsigned>(strings.size() - 1);
+}
+
+string_view Paint::StringPool::Get(unsigned id) const
+{
+  return strings.at(id);
+}
+
+void Paint::StringPool::Clear()
+{
+  block = 0;
+  used = 0;
+  strings.clear();
+  fill(slots.begin(), slots.end(), 0);
+}
+
+size_t Paint::StringPool::Bytes() const
+{
+  size_t bytes = strings.capacity() * sizeof(string_view) + slots.capacity() * sizeof(unsigned);
+  for (size_t size : block_sizes) bytes += size;
+  return bytes;
+}
+
+char* Paint::StringPool::Allocate(size_t size)
+{
+  //move on to the next block which is big enough, allocate it if there is none
+  while (block < blocks.size() && used + size > block_sizes[block]) {
+    block++;
+    used = 0;
+  }
+  if (block == blocks.size()) {
+    const size_t block_size = max(BLOCK_SIZE, size);
+    blocks.emplace_back(block_size);
+    block_sizes.push_back(block_size);
+    used = 0;
+  }
+  char* result = blocks[block].data() + used;
+  used += size;
+  return result;
+}
+
+void Paint::StringPool::Rehash(size_t capacity)
+{
+  slots.assign(capacity, 0);
+  const size_t mask = capacity - 1;
+  for (unsigned id = 0; id < strings.size(); ++id) {
+    size_t slot = Hash(strings[id]) & mask;
+    while (slots[slot] != 0) slot = (slot + 1) & mask;
+    slots[slot] = id + 1;
+  }
+}
+
+/* Paint::Scene */
+
+Paint::Scene::Scene()
+{
+}
+
+Paint::Scene::~Scene()
+{
+}
+
+void Paint::Scene::Clear()
+{
+  index.reset();
+  indexed = true;
+  ellipses.clear();
+  lines.clear();
+  labels.clear();
+  pool.Clear();
+}
+
+void Paint::Scene::Reserve(size_t vertexes, size_t edges)
+{
+  ellipses.reserve(vertexes);
+  labels.reserve(vertexes);
+  lines.reserve(edges);
+}
+
+bool Paint::Scene::Empty() const
+{
+  return ellipses.empty() && lines.empty() && labels.empty();
+}
+
+size_t Paint::Scene::Bytes() const
+{
+  return ellipses.capacity() * sizeof(Ellipse) + lines.capacity() * sizeof(Line)
+    + labels.capacity() * sizeof(Label) + pool.Bytes();
+}
+
+size_t Paint::Scene::AddEllipse(Ellipse e)
+{
+  if (index) index->AddEllipse(ellipses.size(), e);
+  ellipses.push_back(e);
+  return ellipses.size() - 1;
+}
+
+size_t Paint::Scene::AddLine(Line l)
+{
+  if (index) index->AddLine(lines.size(), l);
+  lines.push_back(l);
+  return lines.size() - 1;
+}
+
+size_t Paint::Scene::AddLabel(string_view text, Point center)
+{
+  if (index) index->AddLabel(labels.size(), center);
+  labels.push_back(Label{ .text = pool.Intern(text), .center = center });
+  return labels.size() - 1;
+}
+
+size_t Paint::Scene::AddLabel(int number, Point center)
+{
+  char buf[16];
+  const auto end = to_chars(buf, buf + sizeof(buf), number).ptr;
+  return AddLabel(string_view(buf, end - buf), center);
+}
+
+void Paint::Scene::SetEllipse(size_t index, Ellipse e)
+{
+  if (this->index) this->index->MoveEllipse(index, ellipses.at(index), e);
+  ellipses.at(index) = e;
+}
+
+void Paint::Scene::SetLine(size_t index, Line l)
+{
+  if (this->index) this->index->MoveLine(index, lines.at(index), l);
+  lines.at(index) = l;
+}
+
+void Paint::Scene::SetLabel(size_t index, string_view text, Point center)
+{
+  if (this->index) this->index->MoveLabel(index, labels.at(index).center, center);
+  labels.at(index) = Label{ .text = pool.Intern(text), .center = center };
+}
+
+void Paint::Scene::MoveLabel(size_t index, Point center)
+{
+  if (this->index) this->index->MoveLabel(index, labels.at(index).center, center);
+  labels.at(index).center = center;
+}
+
+void Paint::Scene::RemoveEllipse(size_t index)
+{
+  const Ellipse removed = ellipses.at(index);
+  if (this->index) this->index->RemoveEllipse(index, removed, ellipses.size() - 1, ellipses.back());
+  ellipses[index] = ellipses.back();
+  ellipses.pop_back();
+}
+
+void Paint::Scene::RemoveLine(size_t index)
+{
+  const Line removed = lines.at(index);
+  if (this->index) this->index->RemoveLine(index, removed, lines.size() - 1, lines.back());
+  lines[index] = lines.back();
+  lines.pop_back();
+}
+
+void Paint::Scene::RemoveLabel(size_t index)
+{
+  //the text stays in the pool
+  const Point removed = labels.at(index).center;
+  if (this->index) this->index->RemoveLabel(index, removed, labels.size() - 1, labels.back().center);
+  labels[index] = labels.back();
+  labels.pop_back();
+}
+
+void Paint::Scene::SetIndexed(bool indexed)
+{
+  this->indexed = indexed;
+  if (!indexed) index.reset();
+}
+
+const Paint::SceneVector<Paint::Ellipse>& Paint::Scene::GetEllipses() const
+{
+  return ellipses;
+}
+
+const Paint::SceneVector<Paint::Line>& Paint::Scene::GetLines() const
+{
+  return lines;
+}
+
+const Paint::SceneVector<Paint::Label>& Paint::Scene::GetLabels() const
+{
+  return labels;
+}
+
+string_view Paint::Scene::GetText(const Label& label) const
+{
+  return pool.Get(label.text);
+}
+
+void Paint::Scene::Find(Point lt, Point rb, vector<size_t>& found_ellipses,
+  vector<size_t>& found_lines, vector<size_t>& found_labels) const
+{
+  if (!indexed) {
+    //callers check the objects anyway
+    const auto all = [](size_t n, vector<size_t>& found) {
+      found.resize(n);
+      iota(found.begin(), found.end(), size_t{ 0 });
+    };
+    all(ellipses.size(), found_ellipses);
+    all(lines.size(), found_lines);
+    all(labels.size(), found_labels);
+    return;
+  }
+  if (!index) index = make_unique<SceneIndex>(*this);
+  index->Find(lt, rb, found_ellipses, found_lines, found_labels);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#include "accounting.h"
+
+namespace Paint {
+
+  class SceneIndex;
+
+  //scene memory is accounted to it's own stage
+  template<typename T>
+  using SceneVector = Memory::Vector<T, Memory::Stage::SCENE>;
+
+  /* the coordinates of the following structures are notional,
+  that is, they are the coordinates of the
+  notional window 1000x1000 */
+
+  struct Point {
+    int x = 0;
+    int y = 0;
+  };
+
+  struct Ellipse {
+    Point center;
+    //added to the vertex radius, supernodes of clusters are bigger
+    int r = 0;
+  };
+
+  struct Line{
+    Point from;
+    Point to;
+  };
+
+  struct Text {
+    std::string text;
+    Point center;
+  };
+
+  //text of the label lives in the scene string pool
+  struct Label {
+    unsigned text = 0;
+    Point center;
+  };
+
+  /* arena of interned strings: characters are bump-allocated in big blocks,
+  equal strings are stored once, Clear() keeps all the memory for reuse */
+  class StringPool
+  {
+  public:
+    StringPool() = default;
+    //the copy keeps the ids, all strings go to one block
+    StringPool(const StringPool& other);
+    StringPool& operator=(const StringPool& other);
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    unsigned Intern(std::string_view s);
+    std::string_view Get(unsigned id) const;
+    void Clear();
+    //allocated memory
+    size_t Bytes() const;
+
+  private:
+    char* Allocate(size_t size);
+    void Rehash(size_t capacity);
+
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+  private:
+    std::vector<SceneVector<char>> blocks;
+    std::vector<size_t> block_sizes;
+    size_t block = 0;
+    size_t used = 0;
+    SceneVector<std::string_view> strings;
+    //open addressing table of string ids + 1, 0 is empty slot
+    SceneVector<unsigned> slots;
+  };
+
+  /* retained scene: one contiguous array per layer,
+  reset between graphs without giving the memory back */
+  class Scene
+  {
+  public:
+    Scene();
+    ~Scene();
+
+    void Clear();
+    void Reserve(size_t vertexes, size_t edges);
+    bool Empty() const;
+    //allocated memory
+    size_t Bytes() const;
+
+    size_t AddEllipse(Ellipse e);
+    size_t AddLine(Line l);
+    size_t AddLabel(std::string_view text, Point center);
+    size_t AddLabel(int number, Point center);
+
+    void SetEllipse(size_t index, Ellipse e);
+    void SetLine(size_t index, Line l);
+    void SetLabel(size_t index, std::string_view text, Point center);
+    void MoveLabel(size_t index, Point center);
+    //the last object of the layer takes the index of the removed one
+    void RemoveEllipse(size_t index);
+    void RemoveLine(size_t index);
+    void RemoveLabel(size_t index);
+    //the unindexed scene keeps no index and finds all the objects:
+    //the setters may be called from several threads for disjoint objects
+    //and don't pay for index updates, e.g. during an animation.
+    //The scene is indexed again after Clear
+    void SetIndexed(bool indexed);
+
+    const SceneVector<Ellipse>& GetEllipses() const;
+    const SceneVector<Line>& GetLines() const;
+    const SceneVector<Label>& GetLabels() const;
+    std::string_view GetText(const Label& label) const;
+
+    //objects which may touch the notional box, ascending in every layer.
+    //The index is built by the first query and kept by the setters,
+    //additions and removals
+    void Find(Point lt, Point rb, std::vector<size_t>& ellipses,
+      std::vector<size_t>& lines, std::vector<size_t>& labels) const;
+
+  private:
+    SceneVector<Ellipse> ellipses;
+    SceneVector<Line> lines;
+    SceneVector<Label> labels;
+    StringPool pool;
+    mutable std::unique_ptr<SceneIndex> index;
+    bool indexed = true;
+  };
+
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+
+#include "scene_index.h"
+#include "graph.h"
+
+using namespace std;
+
+namespace {
+
+  //about a couple of lines per cell, not more cells than the area has pixels
+  const int MAX_CELLS = 1024;
+
+  //sorted indexes of the points
+  void Sorted(const vector<int>& ids, vector<size_t>& found)
+  {
+    found.assign(ids.begin(), ids.end());
+    sort(found.begin(), found.end());
+  }
+
+}
+
+Paint::SceneIndex::SceneIndex(const Scene& scene)
+  : ellipses(Graph::AREA_SIZE), labels(Graph::AREA_SIZE)
+{
+  const auto& es = scene.GetEllipses();
+  for (size_t i = 0; i < es.size(); ++i) {
+    ellipses.Insert(static_cast<int>(i), es[i].center);
+    max_r = max(max_r, es[i].r);
+  }
+  const auto& ls = scene.GetLabels();
+  for (size_t i = 0; i < ls.size(); ++i) {
+    labels.Insert(static_cast<int>(i), ls[i].center);
+  }
+
+  const auto& lines = scene.GetLines();
+  cells = clamp(static_cast<int>(sqrt(lines.size() / 2.)), 1, MAX_CELLS);
+  cell_size = Graph::AREA_SIZE / cells + 1;
+  buckets.resize(static_cast<size_t>(cells) * cells);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    ForCells(lines[i], [&](size_t cell) { buckets[cell].push_back(static_cast<unsigned>(i)); });
+  }
+}
+
+void Paint::SceneIndex::AddEllipse(size_t index, Ellipse e)
+{
+  ellipses.Insert(static_cast<int>(index), e.center);
+  max_r = max(max_r, e.r);
+}
+
+void Paint::SceneIndex::AddLine(size_t index, Line l)
+{
+  ForCells(l, [&](size_t cell) { buckets[cell].push_back(static_cast<unsigned>(index)); });
+}
+
+void Paint::SceneIndex::AddLabel(size_t index, Point center)
+{
+  labels.Insert(static_cast<int>(index), center);
+}
+
+void Paint::SceneIndex::MoveEllipse(size_t index, Ellipse from, Ellipse to)
+{
+  ellipses.Move(static_cast<int>(index), from.center, to.center);
+  max_r = max(max_r, to.r);
+}
+
+void Paint::SceneIndex::MoveLine(size_t index, Line from, Line to)
+{
+  Unlink(index, from);
+  AddLine(index, to);
+}
+
+void Paint::SceneIndex::MoveLabel(size_t index, Point from, Point to)
+{
+  labels.Move(static_cast<int>(index), from, to);
+}
+
+void Paint::SceneIndex::RemoveEllipse(size_t index, Ellipse removed, size_t last, Ellipse moved)
+{
+  ellipses.Remove(static_cast<int>(index), removed.center);
+  if (last == index) return;
+  ellipses.Remove(static_cast<int>(last), moved.center);
+  AddEllipse(index, moved);
+}
+
+void Paint::SceneIndex::RemoveLine(size_t index, Line removed, size_t last, Line moved)
+{
+  Unlink(index, removed);
+  if (last == index) return;
+  Unlink(last, moved);
+  AddLine(index, moved);
+}
+
+void Paint::SceneIndex::RemoveLabel(size_t index, Point removed, size_t last, Point moved)
+{
+  labels.Remove(static_cast<int>(index), removed);
+  if (last == index) return;
+  labels.Remove(static_cast<int>(last), moved);
+  AddLabel(index, moved);
+}
+
+void Paint::SceneIndex::Find(Point lt, Point rb, vector<size_t>& found_ellipses,
+  vector<size_t>& found_lines, vector<size_t>& found_labels) const
+{
+  vector<int> ids;
+  //bigger ellipses reach the box from farther
+  ellipses.Find(Point{ lt.x - max_r, lt.y - max_r }, Point{ rb.x + max_r, rb.y + max_r }, ids);
+  Sorted(ids, found_ellipses);
+  ids.clear();
+  labels.Find(lt, rb, ids);
+  Sorted(ids, found_labels);
+
+  //long lines are in many cells, they are found once
+  found_lines.clear();
+  for (int cy = Cell(lt.y); cy <= Cell(rb.y); ++cy) {
+    for (int cx = Cell(lt.x); cx <= Cell(rb.x); ++cx) {
+      const auto& bucket = buckets[static_cast<size_t>(cy) * cells + cx];
+      found_lines.insert(found_lines.end(), bucket.begin(), bucket.end());
+    }
+  }
+  sort(found_lines.begin(), found_lines.end());
+  found_lines.erase(unique(found_lines.begin(), found_lines.end()), found_lines.end());
+}
+
+template<typename Proc>
+void Paint::SceneIndex::ForCells(Line l, Proc proc) const
+{
+  if (l.to.x < l.from.x) swap(l.from, l.to);
+  const int first = Cell(l.from.x);
+  const int last = Cell(l.to.x);
+  for (int cx = first; cx <= last; ++cx) {
+    //rows the line crosses inside of the column, the columns share their borders
+    double y1 = l.from.y;
+    double y2 = l.to.y;
+    if (first != last) {
+      const double slope = static_cast<double>(l.to.y - l.from.y) / (l.to.x - l.from.x);
+      const int x1 = cx == first ? l.from.x : cx * cell_size;
+      const int x2 = cx == last ? l.to.x : (cx + 1) * cell_size;
+      y1 = l.from.y + slope * (x1 - l.from.x);
+      y2 = l.from.y + slope * (x2 - l.from.x);
+    }
+    const int top = Cell(static_cast<int>(floor(min(y1, y2))));
+    const int bottom = Cell(static_cast<int>(ceil(max(y1, y2))));
+    for (int cy = top; cy <= bottom; ++cy) {
+      proc(static_cast<size_t>(cy) * cells + cx);
+    }
+  }
+}
+
+void Paint::SceneIndex::Unlink(size_t index, Line l)
+{
+  ForCells(l, [&](size_t cell) {
+    auto& bucket = buckets[cell];
+    auto it = find(bucket.begin(), bucket.end(), static_cast<unsigned>(index));
+    if (it == bucket.end()) throw 0;
+    *it = bucket.back();
+    bucket.pop_back();
+    });
+}
+
+int Paint::SceneIndex::Cell(int coordinate) const
+{
+  return clamp(coordinate / cell_size, 0, cells - 1);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+
+#include "scene.h"
+#include "quadtree.h"
+
+namespace Paint {
+
+  /* spatial index of the scene objects in notional coordinates:
+  ellipses and labels are points of quadtrees, lines are kept in the buckets
+  of every cell of the uniform grid they cross. Moving one object touches
+  only it's own leaf or cells */
+  class SceneIndex
+  {
+  public:
+    SceneIndex(const Scene& scene);
+
+    void AddEllipse(size_t index, Ellipse e);
+    void AddLine(size_t index, Line l);
+    void AddLabel(size_t index, Point center);
+
+    void MoveEllipse(size_t index, Ellipse from, Ellipse to);
+    void MoveLine(size_t index, Line from, Line to);
+    void MoveLabel(size_t index, Point from, Point to);
+
+    //the object at the last index takes the index of the removed one
+    void RemoveEllipse(size_t index, Ellipse removed, size_t last, Ellipse moved);
+    void RemoveLine(size_t index, Line removed, size_t last, Line moved);
+    void RemoveLabel(size_t index, Point removed, size_t last, Point moved);
+
+    //objects which may touch the box [lt; rb], ascending in every layer
+    void Find(Point lt, Point rb, std::vector<size_t>& ellipses,
+      std::vector<size_t>& lines, std::vector<size_t>& labels) const;
+
+  private:
+    //calls proc with every cell the line crosses
+    template<typename Proc>
+    void ForCells(Line l, Proc proc) const;
+    //takes the line out of the cells it crosses
+    void Unlink(size_t index, Line l);
+    //coordinate -> cell column or row, points out of the area go to the border cells
+    int Cell(int coordinate) const;
+
+  private:
+    QuadTree ellipses;
+    QuadTree labels;
+    //the biggest radius added to the vertex one
+    int max_r = 0;
+    //cells per side of the area
+    int cells = 1;
+    int cell_size = 1;
+    std::vector<SceneVector<unsigned>> buckets;
+  };
+
+}
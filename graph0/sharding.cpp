@@ -0,0 +1,366 @@
+#include "windows.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cwchar>
+#include <queue>
+#include <sstream>
+
+#include "sharding.h"
+#include "parallel.h"
+#include "pipeline.h"
+
+using namespace std;
+
+namespace {
+
+  const uint32_t MAGIC = 0x68726473;
+
+  //byte offsets of the shard arrays in the mapping
+  struct Shard {
+    uint64_t components = 0;
+    uint64_t vertexes = 0;
+    uint64_t arcs = 0;
+    //components + 1 first vertexes
+    uint64_t starts = 0;
+    //vertexes + 1, positions in the targets of the shard
+    uint64_t offsets = 0;
+    //local indexes inside of the component
+    uint64_t targets = 0;
+    uint64_t ids = 0;
+    //x and y of every vertex, written by the worker
+    uint64_t points = 0;
+    //set by the worker after the points
+    uint32_t done = 0;
+  };
+
+  struct Header {
+    uint32_t magic = MAGIC;
+    uint32_t shards = 0;
+    uint32_t strategy = 0;
+    uint32_t tree_strategy = 0;
+    uint64_t size = 0;
+  };
+
+  //named shared memory, it's parts are mapped by the views
+  class Mapping {
+  public:
+    Mapping(const wstring& name, uint64_t size)
+    {
+      handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), name.c_str());
+      if (!handle) throw 0;
+    }
+
+    Mapping(const wstring& name)
+    {
+      handle = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+      if (!handle) throw 0;
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping()
+    {
+      CloseHandle(handle);
+    }
+
+    HANDLE Handle() const
+    {
+      return handle;
+    }
+
+  private:
+    HANDLE handle = nullptr;
+  };
+
+  //bytes [offset; offset + bytes) of the mapping, addressed by the offsets in the whole mapping
+  class View {
+  public:
+    View(const Mapping& mapping, uint64_t offset, uint64_t bytes)
+    {
+      //the view starts at the allocation granularity
+      static const uint64_t granularity = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<uint64_t>(info.dwAllocationGranularity);
+      }();
+      begin = offset / granularity * granularity;
+      base = MapViewOfFile(mapping.Handle(), FILE_MAP_ALL_ACCESS, static_cast<DWORD>(begin >> 32),
+        static_cast<DWORD>(begin), static_cast<SIZE_T>(offset + bytes - begin));
+      if (!base) throw 0;
+    }
+
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    ~View()
+    {
+      UnmapViewOfFile(base);
+    }
+
+    template<typename T>
+    T* At(uint64_t offset) const
+    {
+      return reinterpret_cast<T*>(static_cast<char*>(base) + (offset - begin));
+    }
+
+  private:
+    uint64_t begin = 0;
+    void* base = nullptr;
+  };
+
+  struct Worker {
+    HANDLE process = nullptr;
+    chrono::steady_clock::time_point deadline;
+    unsigned attempts = 0;
+  };
+
+  HANDLE Launch(const wstring& mapping, size_t shard)
+  {
+    vector<wchar_t> path(32768);
+    const DWORD length = GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size()));
+    if (length == 0 || length == path.size()) throw 0;
+    wstring command = L"\"" + wstring(path.data(), length) + L"\" "
+      + Math::ShardedLayout::WORKER_FLAG + L" " + mapping + L" " + to_wstring(shard);
+
+    STARTUPINFOW startup{};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION info{};
+    if (!CreateProcessW(nullptr, command.data(), nullptr, nullptr, FALSE,
+      CREATE_NO_WINDOW, nullptr, nullptr, &startup, &info)) {
+      throw 0;
+    }
+    CloseHandle(info.hThread);
+    return info.hProcess;
+  }
+
+}
+
+Math::ShardedLayout::ShardedLayout()
+  : ShardedLayout(Settings{})
+{
+}
+
+Math::ShardedLayout::ShardedLayout(Settings settings)
+  : settings(settings)
+{
+  if (this->settings.shards == 0) this->settings.shards = Parallel::Threads();
+  if (this->settings.attempts == 0) throw 0;
+}
+
+Paint::Graph Math::ShardedLayout::Lay(CSRView graph) const
+{
+  const Components components(graph);
+  const u_int count = components.Count();
+  if (count == 0) return Paint::Graph({}, {});
+
+  //the biggest components first, each to the least loaded shard
+  vector<u_int> order(count);
+  for (u_int c = 0; c < count; ++c) order[c] = c;
+  auto weight = [&](u_int c) {
+    const CSRView part = components.Slice(c);
+    return static_cast<uint64_t>(part.size) + part.Arcs();
+  };
+  sort(order.begin(), order.end(), [&](u_int a, u_int b) { return weight(a) > weight(b); });
+  const size_t shards = min<size_t>(min<size_t>(settings.shards, count), MAXIMUM_WAIT_OBJECTS);
+  vector<vector<u_int>> members(shards);
+  {
+    priority_queue<pair<uint64_t, size_t>, vector<pair<uint64_t, size_t>>, greater<>> load;
+    for (size_t s = 0; s < shards; ++s) load.emplace(0, s);
+    for (u_int c : order) {
+      auto [l, s] = load.top();
+      load.pop();
+      members[s].push_back(c);
+      load.emplace(l + weight(c), s);
+    }
+  }
+
+  //arrays of every shard one after another, 8-byte aligned
+  vector<Shard> layout(shards);
+  uint64_t size = sizeof(Header) + shards * sizeof(Shard);
+  auto place = [&size](uint64_t bytes) {
+    const uint64_t offset = size;
+    size += (bytes + 7) / 8 * 8;
+    return offset;
+  };
+  for (size_t s = 0; s < shards; ++s) {
+    Shard& shard = layout[s];
+    shard.components = members[s].size();
+    for (u_int c : members[s]) {
+      shard.vertexes += components.Slice(c).size;
+      shard.arcs += components.Slice(c).Arcs();
+    }
+    shard.starts = place((shard.components + 1) * sizeof(u_int));
+    shard.offsets = place((shard.vertexes + 1) * sizeof(u_int));
+    shard.targets = place(shard.arcs * sizeof(u_int));
+    shard.ids = place(shard.vertexes * sizeof(u_int));
+    shard.points = place(shard.vertexes * 2 * sizeof(int32_t));
+  }
+
+  static atomic<unsigned> serial = 0;
+  const wstring name = L"Local\\graph0_layout_" + to_wstring(GetCurrentProcessId())
+    + L"_" + to_wstring(serial++);
+  const Mapping mapping(name, size);
+  const View view(mapping, 0, size);
+  *view.At<Header>(0) = Header{
+    .shards = static_cast<uint32_t>(shards),
+    .strategy = static_cast<uint32_t>(settings.strategy),
+    .tree_strategy = static_cast<uint32_t>(settings.tree_strategy),
+    .size = size
+  };
+  Parallel::For(0, shards, [&](size_t s) {
+    const Shard& shard = layout[s];
+    *view.At<Shard>(sizeof(Header) + s * sizeof(Shard)) = shard;
+    u_int* starts = view.At<u_int>(shard.starts);
+    u_int* offsets = view.At<u_int>(shard.offsets);
+    u_int* targets = view.At<u_int>(shard.targets);
+    u_int* ids = view.At<u_int>(shard.ids);
+    u_int vertex = 0;
+    u_int arc = 0;
+    for (size_t k = 0; k < members[s].size(); ++k) {
+      const CSRView part = components.Slice(members[s][k]);
+      starts[k] = vertex;
+      for (u_int v = 0; v < part.size; ++v, ++vertex) {
+        offsets[vertex] = arc;
+        ids[vertex] = part.ids[v];
+        for (u_int n : part.Neighbours(v)) targets[arc++] = n;
+      }
+    }
+    starts[members[s].size()] = vertex;
+    offsets[vertex] = arc;
+    }, 1);
+
+  //every shard is run again on it's own until it succeeds or has no attempts left
+  vector<Worker> workers(shards);
+  auto start = [&](size_t s) {
+    Worker& w = workers[s];
+    if (w.attempts++ == settings.attempts) throw 0;
+    view.At<Shard>(sizeof(Header) + s * sizeof(Shard))->done = 0;
+    w.process = Launch(name, s);
+    w.deadline = chrono::steady_clock::now() + chrono::milliseconds(settings.timeout_ms);
+  };
+  auto stop_all = [&]() {
+    for (auto& w : workers) {
+      if (!w.process) continue;
+      TerminateProcess(w.process, 1);
+      CloseHandle(w.process);
+      w.process = nullptr;
+    }
+  };
+  try {
+    for (size_t s = 0; s < shards; ++s) start(s);
+    size_t running = shards;
+    while (running > 0) {
+      vector<HANDLE> handles;
+      vector<size_t> index;
+      auto wait = chrono::milliseconds(settings.timeout_ms);
+      const auto now = chrono::steady_clock::now();
+      for (size_t s = 0; s < shards; ++s) {
+        if (!workers[s].process) continue;
+        handles.push_back(workers[s].process);
+        index.push_back(s);
+        wait = min(wait, chrono::duration_cast<chrono::milliseconds>(workers[s].deadline - now));
+      }
+      const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(),
+        FALSE, static_cast<DWORD>(max<long long>(0, wait.count())));
+      if (result == WAIT_FAILED) throw 0;
+
+      for (size_t k = 0; k < handles.size(); ++k) {
+        const size_t s = index[k];
+        Worker& w = workers[s];
+        DWORD code = STILL_ACTIVE;
+        GetExitCodeProcess(w.process, &code);
+        if (code == STILL_ACTIVE) {
+          if (chrono::steady_clock::now() < w.deadline) continue;
+          TerminateProcess(w.process, 1);
+          WaitForSingleObject(w.process, INFINITE);
+        }
+        CloseHandle(w.process);
+        w.process = nullptr;
+        const bool done = code == 0 && view.At<Shard>(sizeof(Header) + s * sizeof(Shard))->done;
+        if (done) running--;
+        else start(s);
+      }
+    }
+  }
+  catch (...) {
+    stop_all();
+    throw;
+  }
+
+  //the parts are made of the written points and the edges of the slices
+  vector<Paint::Graph> parts;
+  parts.reserve(count);
+  for (size_t s = 0; s < shards; ++s) {
+    const int32_t* points = view.At<int32_t>(layout[s].points);
+    u_int vertex = 0;
+    for (u_int c : members[s]) {
+      const CSRView part = components.Slice(c);
+      vector<Paint::Vertex> vertexes;
+      Paint::Edges edges;
+      vertexes.reserve(part.size);
+      edges.reserve(part.Arcs() / 2);
+      for (u_int v = 0; v < part.size; ++v, ++vertex) {
+        const int id = static_cast<int>(part.ids[v]);
+        vertexes.push_back(Paint::Vertex{ id, Paint::Point{ points[2 * vertex], points[2 * vertex + 1] } });
+        for (u_int n : part.Neighbours(v)) {
+          if (v < n) edges.push_back(Paint::Edge{ id, static_cast<int>(part.ids[n]) });
+        }
+      }
+      parts.emplace_back(vertexes, move(edges));
+    }
+  }
+  return Policy::Join{}(move(parts), graph.size);
+}
+
+int Math::ShardedLayout::Work(const wstring& command_line)
+{
+  try {
+    wistringstream in(command_line);
+    wstring flag;
+    wstring name;
+    size_t s = 0;
+    if (!(in >> flag >> name >> s) || flag != WORKER_FLAG) return 1;
+
+    //the worker maps the header and only the arrays of it's own shard
+    const Mapping mapping(name);
+    const View table(mapping, 0, sizeof(Header) + (s + 1) * sizeof(Shard));
+    const Header& header = *table.At<Header>(0);
+    if (header.magic != MAGIC || s >= header.shards) return 1;
+    Shard& shard = *table.At<Shard>(sizeof(Header) + s * sizeof(Shard));
+    //the arrays of the shard are one after another, the points are the last
+    const View arrays(mapping, shard.starts, shard.points + shard.vertexes * 2 * sizeof(int32_t) - shard.starts);
+    const u_int* starts = arrays.At<u_int>(shard.starts);
+    const u_int* offsets = arrays.At<u_int>(shard.offsets);
+    const u_int* targets = arrays.At<u_int>(shard.targets);
+    const u_int* ids = arrays.At<u_int>(shard.ids);
+    int32_t* points = arrays.At<int32_t>(shard.points);
+
+    const Policy::Dynamic strategy{
+      .strategy = static_cast<Strategy>(header.strategy),
+      .tree_strategy = static_cast<TreeStrategy>(header.tree_strategy)
+    };
+    for (uint64_t c = 0; c < shard.components; ++c) {
+      const CSRView part{
+        .size = starts[c + 1] - starts[c],
+        .offsets = offsets + starts[c],
+        .targets = targets,
+        .ids = ids + starts[c]
+      };
+      const Paint::Graph laid = strategy(part);
+      for (u_int v = 0; v < part.size; ++v) {
+        const Paint::Point p = laid.GetVertexes().at(static_cast<int>(part.ids[v])).p;
+        points[2 * (starts[c] + v)] = p.x;
+        points[2 * (starts[c] + v) + 1] = p.y;
+      }
+    }
+    atomic_thread_fence(memory_order_release);
+    shard.done = 1;
+    return 0;
+  }
+  catch (...) {
+    return 2;
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+
+#include "graph.h"
+#include "components.h"
+
+namespace Math {
+
+  /* layout of the components in worker processes of this executable:
+  components are spread over the shards by size, every shard gets it's CSR slices
+  in one shared memory mapping and writes the coordinates next to them,
+  a worker maps only the header and the arrays of it's shard.
+  A shard which crashed or ran out of time is run again on it's own,
+  the coordinator packs the parts with Paint::Graph::Join */
+  class ShardedLayout
+  {
+  public:
+    struct Settings {
+      //0 - one per hardware thread
+      unsigned shards = 0;
+      unsigned timeout_ms = 60000;
+      //runs of one shard before the layout fails
+      unsigned attempts = 3;
+      Strategy strategy = Strategy::AUTO;
+      TreeStrategy tree_strategy = TreeStrategy::RADIAL;
+    };
+
+    ShardedLayout();
+    ShardedLayout(Settings settings);
+
+    //waits for the workers, up to timeout_ms for every attempt,
+    //so the window runs it on a thread of it's own
+    Paint::Graph Lay(CSRView graph) const;
+
+    //the command line of the worker starts with it
+    static constexpr const wchar_t* WORKER_FLAG = L"--layout-worker";
+    //worker side: lays the shard named in the command line, returns the exit code
+    static int Work(const std::wstring& command_line);
+
+  private:
+    Settings settings;
+  };
+
+}
@@ -0,0 +1,233 @@
+#include <cmath>
+#include <algorithm>
+
+#include "spectral.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  //Lanczos vectors and eigenvectors are accounted to the layout stage
+  using Values = Memory::Vector<double, Memory::Stage::LAYOUT>;
+
+  //elements of a vector orthogonalized at once, they stay in the L1 cache
+  const size_t BLOCK = 1024;
+
+  double Dot(const Values& a, const Values& b)
+  {
+    vector<double> partial(Parallel::Threads(), 0);
+    Parallel::ForChunks(0, a.size(), [&](size_t chunk, size_t from, size_t to) {
+      double s = 0;
+      for (size_t i = from; i < to; ++i) s += a[i] * b[i];
+      partial[chunk] = s;
+      });
+    double s = 0;
+    for (double p : partial) s += p;
+    return s;
+  }
+
+  /* removes from a it's components along the constant vector, it's the trivial
+  eigenvector, and along the orthonormal basis vectors of length n by classical
+  Gram-Schmidt. The second round is done if the first one cancelled most of a,
+  that keeps it as stable as the modified one. A round subtracts the projections
+  of the previous one and takes all the dot products in one parallel pass.
+  coef gets the removed components along the basis, returns |a|^2 after the removal */
+  double Orthogonalize(double* a, size_t n, const vector<const double*>& basis, vector<double>& coef)
+  {
+    const size_t b = basis.size();
+    //sum of a, it's the dot with the constant vector, a * a, then the dots with the basis
+    const size_t width = b + 2;
+    vector<double> dots(Parallel::Threads() * width);
+    //subtracts the projections if there are some, then takes the dots if asked
+    auto pass = [&](const vector<double>* projections, bool project) {
+      fill(dots.begin(), dots.end(), 0.);
+      Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+        double* d = dots.data() + chunk * width;
+        //a block of a stays in the cache while the basis passes it
+        for (size_t block = from; block < to; block += BLOCK) {
+          const size_t end = min(to, block + BLOCK);
+          if (projections) {
+            const auto& k = *projections;
+            const double mean = k[0];
+            for (size_t i = block; i < end; ++i) a[i] -= mean;
+            for (size_t j = 0; j < b; ++j) {
+              const double* q = basis[j];
+              const double kj = k[j + 2];
+              for (size_t i = block; i < end; ++i) a[i] -= kj * q[i];
+            }
+          }
+          for (size_t i = block; i < end; ++i) {
+            d[0] += a[i];
+            d[1] += a[i] * a[i];
+          }
+          if (!project) continue;
+          for (size_t j = 0; j < b; ++j) {
+            const double* q = basis[j];
+            double s = 0;
+            for (size_t i = block; i < end; ++i) s += a[i] * q[i];
+            d[j + 2] += s;
+          }
+        }
+        });
+      vector<double> k(width, 0);
+      for (size_t chunk = 0; chunk < Parallel::Threads(); ++chunk) {
+        for (size_t j = 0; j < width; ++j) k[j] += dots[chunk * width + j];
+      }
+      k[0] /= n;
+      return k;
+    };
+
+    const vector<double> first = pass(nullptr, true);
+    coef.assign(first.begin() + 2, first.end());
+    const vector<double> second = pass(&first, true);
+    if (second[1] > first[1] / 2) return second[1];
+    for (size_t j = 0; j < b; ++j) coef[j] += second[j + 2];
+    return pass(&second, false)[1];
+  }
+
+  //eigenpairs of symmetric m x m matrix by cyclic Jacobi rotations,
+  //vectors are columns of v
+  void Jacobi(vector<double> a, u_int m, vector<double>& values, vector<double>& v)
+  {
+    v.assign(m * m, 0);
+    for (u_int i = 0; i < m; ++i) v[i * m + i] = 1;
+    for (int sweep = 0; sweep < 100; ++sweep) {
+      double off = 0;
+      for (u_int p = 0; p < m; ++p) {
+        for (u_int q = p + 1; q < m; ++q) off += a[p * m + q] * a[p * m + q];
+      }
+      if (off < 1e-22) break;
+      for (u_int p = 0; p < m; ++p) {
+        for (u_int q = p + 1; q < m; ++q) {
+          if (abs(a[p * m + q]) < 1e-300) continue;
+          const double theta = (a[q * m + q] - a[p * m + p]) / (2 * a[p * m + q]);
+          const double t = (theta >= 0 ? 1. : -1.) / (abs(theta) + sqrt(theta * theta + 1));
+          const double c = 1 / sqrt(t * t + 1);
+          const double s = t * c;
+          for (u_int k = 0; k < m; ++k) {
+            const double akp = a[k * m + p];
+            const double akq = a[k * m + q];
+            a[k * m + p] = c * akp - s * akq;
+            a[k * m + q] = s * akp + c * akq;
+          }
+          for (u_int k = 0; k < m; ++k) {
+            const double apk = a[p * m + k];
+            const double aqk = a[q * m + k];
+            a[p * m + k] = c * apk - s * aqk;
+            a[q * m + k] = s * apk + c * aqk;
+          }
+          for (u_int k = 0; k < m; ++k) {
+            const double vkp = v[k * m + p];
+            const double vkq = v[k * m + q];
+            v[k * m + p] = c * vkp - s * vkq;
+            v[k * m + q] = s * vkp + c * vkq;
+          }
+        }
+      }
+    }
+    values.resize(m);
+    for (u_int i = 0; i < m; ++i) values[i] = a[i * m + i];
+  }
+
+}
+
+Math::Coordinates Math::SpectralLayout(CSRView graph, u_int steps, u_int restarts)
+{
+  const u_int n = graph.size;
+  Coordinates result;
+  result.x.assign(n, 0);
+  result.y.assign(n, 0);
+  if (n < 3) {
+    for (u_int v = 0; v < n; ++v) result.x[v] = v;
+    return result;
+  }
+
+  //the largest eigenvalues of shift * I - L are the smallest ones of L
+  u_int max_degree = 0;
+  for (u_int v = 0; v < n; ++v) max_degree = max(max_degree, graph.Degree(v));
+  const double shift = 2. * max_degree;
+  auto apply = [&](const double* x, Values& y) {
+    Parallel::For(0, n, [&](size_t v) {
+      double s = (shift - graph.Degree(v)) * x[v];
+      for (u_int u : graph.Neighbours(v)) s += x[u];
+      y[v] = s;
+      }, 1 << 12);
+  };
+
+  const u_int m = min(steps, n - 1);
+  //Lanczos vectors are the rows of q
+  Values q(static_cast<size_t>(m) * n);
+  auto row = [&](u_int k) { return q.data() + static_cast<size_t>(k) * n; };
+  Values w(n);
+  //unit eigenvectors found so far; one Lanczos run finds a single vector
+  //of a multiple eigenvalue, so they are found one by one with deflation
+  vector<Values> found;
+  vector<const double*> basis;
+  vector<double> coef;
+
+  for (u_int dim = 0; dim < 2; ++dim) {
+    //start vector has no symmetry to not miss any eigenvector
+    Values start(n);
+    for (u_int v = 0; v < n; ++v) start[v] = sin(1. + (dim + 1) * v * 0.7548776662) + 0.1 * (v % 3);
+    Values ritz(n, 0);
+
+    for (u_int restart = 0; restart <= restarts; ++restart) {
+      basis.clear();
+      for (const auto& f : found) basis.push_back(f.data());
+      const double norm = sqrt(Orthogonalize(start.data(), n, basis, coef));
+      if (norm < 1e-12) break;
+      for (u_int v = 0; v < n; ++v) row(0)[v] = start[v] / norm;
+
+      //Lanczos with full reorthogonalization against the Lanczos vectors and the found ones
+      vector<double> alpha(m, 0);
+      vector<double> beta(m, 0);
+      u_int k = 0;
+      for (; k < m; ++k) {
+        apply(row(k), w);
+        basis.clear();
+        for (u_int j = 0; j <= k; ++j) basis.push_back(row(j));
+        for (const auto& f : found) basis.push_back(f.data());
+        const double rest = Orthogonalize(w.data(), n, basis, coef);
+        alpha[k] = coef[k];
+        if (k + 1 == m) {
+          k++;
+          break;
+        }
+        beta[k] = sqrt(rest);
+        if (beta[k] < 1e-10) {
+          k++;
+          break;
+        }
+        for (u_int v = 0; v < n; ++v) row(k + 1)[v] = w[v] / beta[k];
+      }
+
+      //Ritz vector of the largest eigenvalue of the tridiagonal matrix
+      vector<double> t(k * k, 0);
+      for (u_int i = 0; i < k; ++i) {
+        t[i * k + i] = alpha[i];
+        if (i + 1 < k) t[i * k + i + 1] = t[(i + 1) * k + i] = beta[i];
+      }
+      vector<double> values, vectors;
+      Jacobi(move(t), k, values, vectors);
+      const u_int e = max_element(values.begin(), values.end()) - values.begin();
+      Parallel::For(0, n, [&](size_t v) {
+        double x = 0;
+        for (u_int i = 0; i < k; ++i) x += vectors[i * k + e] * row(i)[v];
+        ritz[v] = x;
+        });
+      //restart from the Ritz vector
+      start = ritz;
+    }
+
+    const double norm = sqrt(Dot(ritz, ritz));
+    if (norm > 1e-12) {
+      for (double& x : ritz) x /= norm;
+    }
+    found.push_back(move(ritz));
+  }
+
+  result.x.assign(found[0].begin(), found[0].end());
+  result.y.assign(found[1].begin(), found[1].end());
+  return result;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "coordinates.h"
+
+namespace Math {
+
+  /* spectral drawing: coordinates are the two smallest nontrivial
+  eigenvectors of the graph Laplacian, found by restarted Lanczos
+  over the adjacency without building the matrix */
+  Coordinates SpectralLayout(CSRView graph, u_int steps = 40, u_int restarts = 8);
+
+}
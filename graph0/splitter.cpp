@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+#include "splitter.h"
+#include "IOcontroller.h"
+#include "compact_layout.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "doutput.h"
+
+using namespace std;
+
+namespace {
+
+  struct Header {
+    uint32_t magic = 0;
+    uint32_t size = 0;
+    uint64_t arcs = 0;
+  };
+
+  string ShardFile(const string& directory, size_t shard, const char* extension)
+  {
+    return (filesystem::path(directory) / ("shard_" + to_string(shard) + extension)).string();
+  }
+
+  template<typename T, typename Allocator>
+  void ReadArray(ifstream& input, vector<T, Allocator>& a, size_t size)
+  {
+    a.resize(size);
+    input.read(reinterpret_cast<char*>(a.data()), static_cast<streamsize>(size * sizeof(T)));
+    if (static_cast<size_t>(input.gcount()) != size * sizeof(T)) throw 0;
+  }
+
+  template<typename T, typename Allocator>
+  void WriteArray(ofstream& output, const vector<T, Allocator>& a)
+  {
+    output.write(reinterpret_cast<const char*>(a.data()), static_cast<streamsize>(a.size() * sizeof(T)));
+  }
+
+  //the whole temporary file of the shard, the file is removed
+  vector<u_int> ReadShardFile(const string& directory, size_t shard, const char* extension)
+  {
+    const string file = ShardFile(directory, shard, extension);
+    vector<u_int> values;
+    {
+      ifstream input(file, ios::binary);
+      ReadArray(input, values, static_cast<size_t>(filesystem::file_size(file) / sizeof(u_int)));
+    }
+    filesystem::remove(file);
+    return values;
+  }
+
+  /* appends values to the temporary files of the shards: the buffers
+  of all the shards together take about buffer_bytes, every one is written
+  out when it's full, a file is open only while it's written */
+  class ShardWriter {
+  public:
+    ShardWriter(const string& directory, size_t shards, const char* extension, size_t buffer_bytes)
+      : directory(directory), extension(extension), buffers(shards),
+        chunk(max<size_t>(1, buffer_bytes / sizeof(u_int) / max<size_t>(shards, 1)))
+    {
+      for (size_t s = 0; s < shards; ++s) ofstream(ShardFile(directory, s, extension), ios::binary | ios::trunc);
+    }
+
+    void Push(size_t s, u_int value)
+    {
+      auto& buffer = buffers[s];
+      if (buffer.capacity() < chunk) buffer.reserve(chunk);
+      buffer.push_back(value);
+      if (buffer.size() == chunk) Flush(s);
+    }
+
+    //writes the rest of the buffers and frees them
+    void Close()
+    {
+      for (size_t s = 0; s < buffers.size(); ++s) {
+        if (!buffers[s].empty()) Flush(s);
+        vector<u_int>().swap(buffers[s]);
+      }
+    }
+
+  private:
+    void Flush(size_t s)
+    {
+      ofstream output(ShardFile(directory, s, extension), ios::binary | ios::app);
+      WriteArray(output, buffers[s]);
+      if (!output) throw 0;
+      buffers[s].clear();
+    }
+
+  private:
+    const string& directory;
+    const char* extension;
+    vector<vector<u_int>> buffers;
+    const size_t chunk;
+  };
+
+}
+
+Math::ExternalSplitter::ExternalSplitter()
+  : ExternalSplitter(Settings{})
+{
+}
+
+Math::ExternalSplitter::ExternalSplitter(Settings settings)
+  : settings(settings)
+{
+  if (settings.shard_bytes == 0 || settings.buffer_bytes == 0) throw 0;
+}
+
+vector<string> Math::ExternalSplitter::Split(const string& edges, const string& directory) const
+{
+  filesystem::create_directories(directory);
+
+  //the first pass: degrees and union-find, the least vertex is the root of it's component
+  IOcontroller::EdgeStream first(edges);
+  const u_int n = first.Vertexes();
+  vector<u_int> comp(n);
+  iota(comp.begin(), comp.end(), 0);
+  vector<u_int> degree(n, 0);
+  auto find = [&comp](u_int v) {
+    while (comp[v] != v) {
+      comp[v] = comp[comp[v]];
+      v = comp[v];
+    }
+    return v;
+  };
+  u_int a = 0;
+  u_int b = 0;
+  while (first.Next(a, b)) {
+    if (a == b) continue;
+    degree[a]++;
+    degree[b]++;
+    a = find(a);
+    b = find(b);
+    if (a < b) comp[b] = a;
+    else if (b < a) comp[a] = b;
+  }
+
+  //components numbered by their least vertex, the roots come before their vertexes
+  for (u_int v = 0; v < n; ++v) comp[v] = find(v);
+  u_int count = 0;
+  for (u_int v = 0; v < n; ++v) comp[v] = comp[v] == v ? count++ : comp[comp[v]];
+
+  //whole components are packed into shards in their order,
+  //the bytes of a component become it's shard once it's packed
+  vector<uint64_t> bytes(count, 0);
+  for (u_int v = 0; v < n; ++v) bytes[comp[v]] += (2 + static_cast<uint64_t>(degree[v])) * sizeof(u_int);
+  vector<u_int> sizes;
+  vector<uint64_t> arcs;
+  uint64_t used = 0;
+  for (u_int c = 0; c < count; ++c) {
+    if (sizes.empty() || (used > 0 && used + bytes[c] > settings.shard_bytes)) {
+      sizes.push_back(0);
+      arcs.push_back(0);
+      used = 0;
+    }
+    used += bytes[c];
+    bytes[c] = sizes.size() - 1;
+  }
+  for (u_int v = 0; v < n; ++v) comp[v] = static_cast<u_int>(bytes[comp[v]]);
+  vector<uint64_t>().swap(bytes);
+  vector<u_int>& shard_of = comp;
+  const size_t shards = sizes.size();
+
+  //degrees become indexes inside of the shards, the vertexes of every shard
+  //are written in the order of those indexes
+  {
+    ShardWriter ids(directory, shards, ".ids", settings.buffer_bytes);
+    for (u_int v = 0; v < n; ++v) {
+      const u_int s = shard_of[v];
+      arcs[s] += degree[v];
+      degree[v] = sizes[s]++;
+      ids.Push(s, v);
+    }
+    ids.Close();
+  }
+  vector<u_int>& local = degree;
+  for (uint64_t total : arcs) {
+    if (total > UINT32_MAX) throw 0;
+  }
+
+  //the second pass appends the edges to the files of their shards
+  {
+    ShardWriter pairs(directory, shards, ".arcs", settings.buffer_bytes);
+    IOcontroller::EdgeStream second(edges);
+    while (second.Next(a, b)) {
+      if (a == b) continue;
+      const u_int s = shard_of[a];
+      pairs.Push(s, local[a]);
+      pairs.Push(s, local[b]);
+    }
+    pairs.Close();
+  }
+  vector<u_int>().swap(comp);
+  vector<u_int>().swap(degree);
+
+  //every shard is made a CSR in memory on it's own
+  vector<string> files;
+  for (size_t s = 0; s < shards; ++s) {
+    const u_int size = sizes[s];
+    CSR csr;
+    vector<u_int> pairs = ReadShardFile(directory, s, ".arcs");
+    {
+      const vector<u_int> ids = ReadShardFile(directory, s, ".ids");
+      if (ids.size() != size) throw 0;
+      csr.ids.assign(ids.begin(), ids.end());
+    }
+    csr.offsets.assign(size + 1, 0);
+    for (u_int k : pairs) csr.offsets[k]++;
+    Parallel::PrefixSum(csr.offsets);
+    csr.targets.resize(pairs.size());
+    {
+      vector<u_int> fill(csr.offsets.begin(), csr.offsets.end() - 1);
+      for (size_t i = 0; i < pairs.size(); i += 2) {
+        csr.targets[fill[pairs[i]]++] = pairs[i + 1];
+        csr.targets[fill[pairs[i + 1]]++] = pairs[i];
+      }
+    }
+    vector<u_int>().swap(pairs);
+
+    //repeated edges are kept once
+    u_int kept = 0;
+    for (u_int v = 0; v < size; ++v) {
+      const auto begin = csr.targets.begin() + csr.offsets[v];
+      const auto end = csr.targets.begin() + csr.offsets[v + 1];
+      sort(begin, end);
+      csr.offsets[v] = kept;
+      for (auto it = begin; it != end; ++it) {
+        if (it == begin || *it != *(it - 1)) csr.targets[kept++] = *it;
+      }
+    }
+    csr.offsets[size] = kept;
+    csr.targets.resize(kept);
+
+    files.push_back(ShardFile(directory, s, SHARD_EXTENSION));
+    WriteShard(files.back(), csr);
+  }
+  DOUT("split", n, "vertexes of", count, "components into", shards, "shards");
+  return files;
+}
+
+vector<string> Math::ExternalSplitter::Lay(const vector<string>& shards)
+{
+  vector<string> layouts;
+  for (const string& file : shards) {
+    const CSR csr = ReadShard(file);
+    //the pipeline and the compact layout share the slices of the components
+    const Components components(csr.View());
+    const Paint::CompactLayout layout(DefaultPipeline().Lay(components, csr.View().size), components);
+    layouts.push_back(file + LAYOUT_EXTENSION);
+    ofstream output(layouts.back(), ios::binary);
+    layout.Write(output);
+  }
+  return layouts;
+}
+
+Math::CSR Math::ExternalSplitter::ReadShard(const string& file)
+{
+  ifstream input(file, ios::binary);
+  if (!input) throw 0;
+  Header header;
+  input.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!input || header.magic != MAGIC || header.arcs > UINT32_MAX) throw 0;
+  //the arrays can't be longer than the file
+  const uint64_t length = filesystem::file_size(file);
+  if ((2 * static_cast<uint64_t>(header.size) + 1 + header.arcs) * sizeof(u_int) + sizeof(header) != length) throw 0;
+
+  CSR csr;
+  ReadArray(input, csr.offsets, header.size + size_t(1));
+  ReadArray(input, csr.targets, static_cast<size_t>(header.arcs));
+  ReadArray(input, csr.ids, header.size);
+  if (csr.offsets[0] != 0 || csr.offsets[header.size] != header.arcs) throw 0;
+  for (u_int v = 0; v < header.size; ++v) {
+    if (csr.offsets[v] > csr.offsets[v + 1]) throw 0;
+  }
+  for (u_int t : csr.targets) {
+    if (t >= header.size) throw 0;
+  }
+  return csr;
+}
+
+void Math::ExternalSplitter::WriteShard(const string& file, const CSR& csr)
+{
+  ofstream output(file, ios::binary | ios::trunc);
+  const Header header{
+    .magic = MAGIC,
+    .size = static_cast<uint32_t>(csr.ids.size()),
+    .arcs = csr.targets.size()
+  };
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteArray(output, csr.offsets);
+  WriteArray(output, csr.targets);
+  WriteArray(output, csr.ids);
+  if (!output) throw 0;
+}
+
+int Math::ExternalSplitter::Run(const wstring& command_line)
+{
+  try {
+    wistringstream in(command_line);
+    wstring flag;
+    wstring edges;
+    wstring directory;
+    if (!(in >> flag >> edges >> directory) || flag != SPLIT_FLAG) return 1;
+    const ExternalSplitter splitter;
+    Lay(splitter.Split(filesystem::path(edges).string(), filesystem::path(directory).string()));
+    return 0;
+  }
+  catch (...) {
+    return 2;
+  }
+}
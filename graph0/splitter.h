@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+
+#include "graph.h"
+#include "components.h"
+
+namespace Math {
+
+  /* out-of-core split of an edge list which doesn't fit into memory:
+  the edges are streamed from the file twice. The first pass finds the components
+  with union-find, the second one sorts the edges into the shards, every shard
+  is a CSR file of whole components and is laid on it's own.
+  While the file is read, 8 bytes per vertex are kept (component, then shard,
+  and degree, then index in the shard), 8 bytes per component more while
+  the shards are packed, and the buffers. The vertex order of the shards is
+  written to disk. After the passes only one shard is in memory */
+  class ExternalSplitter
+  {
+  public:
+    struct Settings {
+      //CSR bytes of one shard, a bigger component gets a shard of it's own
+      size_t shard_bytes = size_t(64) << 20;
+      //values buffered for all the shards together before they are written,
+      //a buffer holds one value at least, so many shards take 4 bytes each
+      size_t buffer_bytes = size_t(16) << 20;
+    };
+
+    ExternalSplitter();
+    ExternalSplitter(Settings settings);
+
+    //writes the shards of the edge list to the directory, returns their files
+    std::vector<std::string> Split(const std::string& edges, const std::string& directory) const;
+    //lays the shards one at a time, writes Paint::CompactLayout next to every one
+    //of them, returns the layout files
+    static std::vector<std::string> Lay(const std::vector<std::string>& shards);
+
+    //the ids are the vertexes of the edge list
+    static CSR ReadShard(const std::string& file);
+    static void WriteShard(const std::string& file, const CSR& csr);
+
+    static constexpr const char* SHARD_EXTENSION = ".csr";
+    static constexpr const char* LAYOUT_EXTENSION = ".layout";
+
+    //the command line "--split-edges <edges> <directory>" splits and lays the edge list
+    static constexpr const wchar_t* SPLIT_FLAG = L"--split-edges";
+    //returns the exit code of the process
+    static int Run(const std::wstring& command_line);
+
+  private:
+    static const uint32_t MAGIC = 0x72736367;
+
+  private:
+    Settings settings;
+  };
+
+}
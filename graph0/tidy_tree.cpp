@@ -0,0 +1,227 @@
+#include <algorithm>
+
+#include "graph.h"
+#include "components.h"
+#include "coordinates.h"
+
+using namespace std;
+
+/* Buchheim, Junger, Leipert. Improving Walker's Algorithm to Run in Linear Time.
+The first walk goes in post order, the second one in pre order, both by explicit stacks */
+
+namespace {
+
+  constexpr u_int NONE = static_cast<u_int>(-1);
+
+  class TidyTree
+  {
+  public:
+    TidyTree(Math::CSRView tree, u_int root);
+
+    //x of every vertex, depth is y
+    vector<double> Place();
+    const vector<u_int>& GetDepth() const { return depth; }
+
+  private:
+    u_int FirstChild(u_int v) const { return first[v] == last[v] ? NONE : children[first[v]]; }
+    u_int LastChild(u_int v) const { return first[v] == last[v] ? NONE : children[last[v] - 1]; }
+    //the sibling on the left, NONE for the first child
+    u_int LeftSibling(u_int v) const { return number[v] == 0 ? NONE : children[first[parent[v]] + number[v] - 1]; }
+    u_int LeftmostSibling(u_int v) const { return children[first[parent[v]]]; }
+    u_int NextLeft(u_int v) const { const u_int c = FirstChild(v); return c != NONE ? c : thread[v]; }
+    u_int NextRight(u_int v) const { const u_int c = LastChild(v); return c != NONE ? c : thread[v]; }
+
+    void FirstWalk(u_int v);
+    u_int Apportion(u_int v, u_int default_ancestor);
+    void MoveSubtree(u_int wl, u_int wr, double shift);
+    void ExecuteShifts(u_int v);
+
+  private:
+    u_int root;
+    //children of v are children[first[v]; last[v]), number is the index among siblings
+    vector<u_int> first;
+    vector<u_int> last;
+    vector<u_int> children;
+    vector<u_int> parent;
+    vector<u_int> number;
+    vector<u_int> depth;
+
+    vector<double> prelim;
+    vector<double> mod;
+    vector<double> shift;
+    vector<double> change;
+    vector<u_int> thread;
+    vector<u_int> ancestor;
+    //the ancestor the next child's subtree is moved against
+    vector<u_int> default_ancestor;
+
+    //distance between neighbour vertexes of a level
+    static constexpr double DISTANCE = 1;
+  };
+
+  TidyTree::TidyTree(Math::CSRView tree, u_int root)
+    : root(root), first(tree.size, 0), last(tree.size, 0), parent(tree.size, NONE), number(tree.size, 0), depth(tree.size, 0),
+      prelim(tree.size, 0), mod(tree.size, 0), shift(tree.size, 0), change(tree.size, 0),
+      thread(tree.size, NONE), ancestor(tree.size), default_ancestor(tree.size, NONE)
+  {
+    //BFS order gives children of every vertex a contiguous range
+    vector<u_int> order;
+    order.reserve(tree.size);
+    order.push_back(root);
+    parent[root] = root;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const u_int v = order[i];
+      //children of v are the next vertexes of BFS order
+      first[v] = static_cast<u_int>(order.size() - 1);
+      u_int k = 0;
+      for (u_int n : tree.Neighbours(v)) {
+        if (parent[n] != NONE) continue;
+        parent[n] = v;
+        number[n] = k++;
+        depth[n] = depth[v] + 1;
+        order.push_back(n);
+      }
+      last[v] = static_cast<u_int>(order.size() - 1);
+    }
+    children.assign(order.begin() + 1, order.end());
+    for (u_int v = 0; v < tree.size; ++v) ancestor[v] = v;
+    parent[root] = NONE;
+  }
+
+  vector<double> TidyTree::Place()
+  {
+    const u_int n = static_cast<u_int>(parent.size());
+    //post order: (vertex, whether it's children are done)
+    vector<pair<u_int, bool>> stack;
+    stack.emplace_back(root, false);
+    while (!stack.empty()) {
+      auto [v, done] = stack.back();
+      stack.pop_back();
+      if (done) {
+        FirstWalk(v);
+        continue;
+      }
+      stack.emplace_back(v, true);
+      default_ancestor[v] = FirstChild(v);
+      //the first child has to be finished first
+      for (u_int i = last[v]; i > first[v]; --i) stack.emplace_back(children[i - 1], false);
+    }
+
+    //second walk: x is the prelim plus the mods of all ancestors
+    vector<double> x(n, 0);
+    vector<pair<u_int, double>> pre;
+    pre.emplace_back(root, -prelim[root]);
+    while (!pre.empty()) {
+      const auto [v, m] = pre.back();
+      pre.pop_back();
+      x[v] = prelim[v] + m;
+      for (u_int i = first[v]; i < last[v]; ++i) pre.emplace_back(children[i], m + mod[v]);
+    }
+    return x;
+  }
+
+  //all the children of v are finished
+  void TidyTree::FirstWalk(u_int v)
+  {
+    const u_int left = v == root ? NONE : LeftSibling(v);
+    if (FirstChild(v) == NONE) {
+      prelim[v] = left == NONE ? 0 : prelim[left] + DISTANCE;
+    }
+    else {
+      ExecuteShifts(v);
+      const double midpoint = (prelim[FirstChild(v)] + prelim[LastChild(v)]) / 2;
+      if (left != NONE) {
+        prelim[v] = prelim[left] + DISTANCE;
+        mod[v] = prelim[v] - midpoint;
+      }
+      else {
+        prelim[v] = midpoint;
+      }
+    }
+    //the parent places the subtree against it's left siblings
+    if (v != root && left != NONE) {
+      default_ancestor[parent[v]] = Apportion(v, default_ancestor[parent[v]]);
+    }
+  }
+
+  u_int TidyTree::Apportion(u_int v, u_int default_anc)
+  {
+    u_int vir = v;
+    u_int vor = v;
+    u_int vil = LeftSibling(v);
+    u_int vol = LeftmostSibling(v);
+    double sir = mod[vir];
+    double sor = mod[vor];
+    double sil = mod[vil];
+    double sol = mod[vol];
+    while (NextRight(vil) != NONE && NextLeft(vir) != NONE) {
+      vil = NextRight(vil);
+      vir = NextLeft(vir);
+      vol = NextLeft(vol);
+      vor = NextRight(vor);
+      ancestor[vor] = v;
+      const double s = (prelim[vil] + sil) - (prelim[vir] + sir) + DISTANCE;
+      if (s > 0) {
+        const u_int a = parent[ancestor[vil]] == parent[v] ? ancestor[vil] : default_anc;
+        MoveSubtree(a, v, s);
+        sir += s;
+        sor += s;
+      }
+      sil += mod[vil];
+      sir += mod[vir];
+      sol += mod[vol];
+      sor += mod[vor];
+    }
+    if (NextRight(vil) != NONE && NextRight(vor) == NONE) {
+      thread[vor] = NextRight(vil);
+      mod[vor] += sil - sor;
+    }
+    if (NextLeft(vir) != NONE && NextLeft(vol) == NONE) {
+      thread[vol] = NextLeft(vir);
+      mod[vol] += sir - sol;
+      default_anc = v;
+    }
+    return default_anc;
+  }
+
+  void TidyTree::MoveSubtree(u_int wl, u_int wr, double s)
+  {
+    const double subtrees = static_cast<double>(number[wr]) - number[wl];
+    change[wr] -= s / subtrees;
+    shift[wr] += s;
+    change[wl] += s / subtrees;
+    prelim[wr] += s;
+    mod[wr] += s;
+  }
+
+  void TidyTree::ExecuteShifts(u_int v)
+  {
+    double s = 0;
+    double c = 0;
+    for (u_int i = last[v]; i > first[v]; --i) {
+      const u_int w = children[i - 1];
+      prelim[w] += s;
+      mod[w] += s;
+      c += change[w];
+      s += shift[w] + c;
+    }
+  }
+
+}
+
+Paint::Graph Math::Tree::LayTidy(CSRView tree)
+{
+  if (tree.size == 0) return Paint::Graph({}, {});
+  TidyTree tidy(tree, GetCenter(tree).first);
+  Coordinates c;
+  const vector<double> x = tidy.Place();
+  c.x.assign(x.begin(), x.end());
+
+  //levels are spread to make the drawing about square
+  const auto [minX, maxX] = minmax_element(c.x.begin(), c.x.end());
+  const u_int levels = *max_element(tidy.GetDepth().begin(), tidy.GetDepth().end());
+  const double level = levels == 0 ? 1 : max(1., (*maxX - *minX) / levels);
+  c.y.resize(tree.size);
+  for (u_int v = 0; v < tree.size; ++v) c.y[v] = tidy.GetDepth()[v] * level;
+  return ToPaintGraph(tree, c);
+}
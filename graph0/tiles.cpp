@@ -0,0 +1,217 @@
+#include "windows.h"
+#include "gdiplus.h"
+#include <algorithm>
+#include <atomic>
+#include <cwchar>
+
+#include "tiles.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+  CLSID PngEncoder()
+  {
+    using namespace Gdiplus;
+    UINT count = 0;
+    UINT size = 0;
+    GetImageEncodersSize(&count, &size);
+    if (size == 0) throw 0;
+    vector<uint64_t> buffer((size + 7) / 8);
+    auto* codecs = reinterpret_cast<ImageCodecInfo*>(buffer.data());
+    GetImageEncoders(count, size, codecs);
+    for (UINT i = 0; i < count; ++i) {
+      if (wcscmp(codecs[i].MimeType, L"image/png") == 0) return codecs[i].Clsid;
+    }
+    throw 0;
+  }
+
+}
+
+Paint::TileRenderer::TileRenderer(const Painter& painter, int imageW, int imageH, int tile)
+  : painter(painter), map(painter.MapTo(imageW, imageH)),
+    glyphs(painter.settings.font, map.R, painter.settings.label_color),
+    imageW(imageW), imageH(imageH), tile(tile)
+{
+  if (imageW <= 0 || imageH <= 0 || tile <= 0) throw 0;
+  rows = (imageH + tile - 1) / tile;
+  columns = (imageW + tile - 1) / tile;
+  for (auto layer : { Layer::LINE, Layer::ELLIPSE, Layer::TEXT }) BinLayer(layer);
+}
+
+int Paint::TileRenderer::Rows() const
+{
+  return rows;
+}
+
+int Paint::TileRenderer::Columns() const
+{
+  return columns;
+}
+
+span<const uint32_t> Paint::TileRenderer::Bin(Layer layer, int row, int column) const
+{
+  const Bins& b = bins[static_cast<int>(layer)];
+  const size_t cell = static_cast<size_t>(row) * columns + column;
+  return span<const uint32_t>(b.items.data() + b.offsets[cell], b.offsets[cell + 1] - b.offsets[cell]);
+}
+
+//calls proc(cell) for every tile the object touches
+template<typename Proc>
+void Paint::TileRenderer::Cover(Layer layer, size_t i, Proc proc) const
+{
+  const Scene& scene = painter.scene;
+  const int margin = map.R + static_cast<int>(map.edge_width) + 1;
+  auto columns_of = [&](int left, int right, int row) {
+    const int c1 = max(0, left / tile);
+    const int c2 = min(columns - 1, right / tile);
+    for (int c = c1; c <= c2; ++c) proc(static_cast<size_t>(row) * columns + c);
+  };
+  auto box = [&](Point p, int extra = 0) {
+    const int x = map.X(p.x);
+    const int y = map.Y(p.y);
+    const int e = margin + extra;
+    if (x + e < 0 || y + e < 0) return;
+    const int r1 = max(0, (y - e) / tile);
+    const int r2 = min(rows - 1, (y + e) / tile);
+    for (int r = r1; r <= r2; ++r) columns_of(max(0, x - e), x + e, r);
+  };
+
+  if (layer == Layer::ELLIPSE) {
+    const auto& e = scene.GetEllipses()[i];
+    box(e.center, map.Length(e.r));
+  }
+  else if (layer == Layer::TEXT) box(scene.GetLabels()[i].center);
+  else if (layer == Layer::LINE) {
+    //long edges touch only the tiles along them, not their whole box
+    const auto& l = scene.GetLines()[i];
+    double x1 = map.X(l.from.x), y1 = map.Y(l.from.y);
+    double x2 = map.X(l.to.x), y2 = map.Y(l.to.y);
+    if (y2 < y1) {
+      swap(x1, x2);
+      swap(y1, y2);
+    }
+    if (y2 + margin < 0 || max(x1, x2) + margin < 0) return;
+    const int r1 = max(0, static_cast<int>(y1 - margin) / tile);
+    const int r2 = min(rows - 1, static_cast<int>(y2 + margin) / tile);
+    for (int r = r1; r <= r2; ++r) {
+      //part of the segment within the row band
+      const double top = max(y1, static_cast<double>(r) * tile - margin);
+      const double bottom = min(y2, static_cast<double>(r + 1) * tile + margin);
+      double xa = x1, xb = x2;
+      if (y2 > y1) {
+        xa = x1 + (x2 - x1) * (top - y1) / (y2 - y1);
+        xb = x1 + (x2 - x1) * (bottom - y1) / (y2 - y1);
+      }
+      const double left = min(xa, xb) - margin;
+      const double right = max(xa, xb) + margin;
+      if (right < 0) continue;
+      columns_of(static_cast<int>(max(0., left)), static_cast<int>(right), r);
+    }
+  }
+  else throw 0;
+}
+
+void Paint::TileRenderer::BinLayer(Layer layer)
+{
+  //counting sort of (tile, object) pairs: counts per chunk of objects,
+  //so the items of every tile keep the object order
+  const size_t cells = static_cast<size_t>(rows) * columns;
+  const size_t n = painter.Count(layer);
+  const size_t chunks = Parallel::Threads();
+  vector<size_t> counts(cells * chunks, 0);
+  Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      Cover(layer, i, [&](size_t cell) { counts[cell * chunks + chunk]++; });
+    }
+    }, 1 << 12);
+  const size_t total = Parallel::PrefixSum(counts);
+
+  Bins& b = bins[static_cast<int>(layer)];
+  b.items.resize(total);
+  b.offsets.resize(cells + 1);
+  for (size_t cell = 0; cell < cells; ++cell) b.offsets[cell] = counts[cell * chunks];
+  b.offsets[cells] = total;
+  Parallel::ForChunks(0, n, [&](size_t chunk, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      Cover(layer, i, [&](size_t cell) {
+        b.items[counts[cell * chunks + chunk]++] = static_cast<uint32_t>(i);
+        });
+    }
+    }, 1 << 12);
+}
+
+bool Paint::TileRenderer::Render(int row, int column, Gdiplus::Bitmap& bitmap, wstring& buffer) const
+{
+  using namespace Gdiplus;
+  //the tile is the image shifted by its origin
+  Painter::Mapping m = map;
+  m.paddingW -= column * tile;
+  m.paddingH -= row * tile;
+
+  Graphics graphics(&bitmap);
+  graphics.SetSmoothingMode(SmoothingModeHighSpeed);
+  graphics.Clear(painter.settings.bg_color);
+  const Painter::Tools tools(painter.settings, m.R, m.edge_width);
+  vector<uint32_t> rest;
+  for (auto layer : painter.settings.queue) {
+    if (layer != Layer::TEXT) {
+      for (uint32_t i : Bin(layer, row, column)) {
+        painter.DrawObject(graphics, tools, m, layer, i, buffer);
+      }
+      continue;
+    }
+
+    //labels out of the atlas are drawn by GDI+ once the pixels are unlocked
+    graphics.Flush(FlushIntentionSync);
+    const int w = static_cast<int>(bitmap.GetWidth());
+    const int h = static_cast<int>(bitmap.GetHeight());
+    const Rect all(0, 0, w, h);
+    BitmapData data;
+    if (bitmap.LockBits(&all, ImageLockModeRead | ImageLockModeWrite, PixelFormat32bppARGB, &data) != Ok) {
+      return false;
+    }
+    const Surface surface{
+      .pixels = static_cast<uint32_t*>(data.Scan0),
+      .width = w,
+      .height = h,
+      .stride = data.Stride / 4,
+      .clip = RECT{ 0, 0, w, h }
+    };
+    rest.clear();
+    for (uint32_t i : Bin(layer, row, column)) {
+      if (!painter.BlendLabel(surface, glyphs, m, i)) rest.push_back(i);
+    }
+    bitmap.UnlockBits(&data);
+    for (uint32_t i : rest) painter.DrawObject(graphics, tools, m, layer, i, buffer);
+  }
+  return true;
+}
+
+void Paint::TileRenderer::SavePNG(const wstring& directory) const
+{
+  const CLSID png = PngEncoder();
+  const size_t cells = static_cast<size_t>(rows) * columns;
+  atomic<bool> failed = false;
+  Parallel::ForChunks(0, cells, [&](size_t, size_t from, size_t to) {
+    wstring buffer;
+    for (size_t cell = from; cell < to && !failed; ++cell) {
+      const int row = static_cast<int>(cell / columns);
+      const int column = static_cast<int>(cell % columns);
+      Gdiplus::Bitmap bitmap(min(tile, imageW - column * tile), min(tile, imageH - row * tile),
+        PixelFormat32bppARGB);
+      if (bitmap.GetLastStatus() != Gdiplus::Ok) {
+        failed = true;
+        break;
+      }
+      if (!Render(row, column, bitmap, buffer)) {
+        failed = true;
+        break;
+      }
+      const wstring path = directory + L"\\tile_" + to_wstring(row) + L"_" + to_wstring(column) + L".png";
+      if (bitmap.Save(path.c_str(), &png) != Gdiplus::Ok) failed = true;
+    }
+    }, 1);
+  if (failed) throw 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "painter.h"
+
+namespace Paint {
+
+  /* renders the painter scene as an image of any size split into square tiles:
+  objects are binned into the tiles they touch, tiles are drawn in parallel
+  and every worker keeps a single tile bitmap at a time. Digit labels are
+  blended into the locked tile pixels from the glyph atlas */
+  class TileRenderer
+  {
+  public:
+    TileRenderer(const Painter& painter, int imageW, int imageH, int tile = 2048);
+
+    int Rows() const;
+    int Columns() const;
+    //indexes of the layer objects touching the tile, in drawing order
+    std::span<const uint32_t> Bin(Layer layer, int row, int column) const;
+
+    //writes tile_<row>_<column>.png files into the existing directory
+    void SavePNG(const std::wstring& directory) const;
+
+  private:
+    struct Bins {
+      std::vector<size_t> offsets;
+      std::vector<uint32_t> items;
+    };
+
+    template<typename Proc>
+    void Cover(Layer layer, size_t i, Proc proc) const;
+    void BinLayer(Layer layer);
+    //false if the bitmap pixels could not be locked for the labels
+    bool Render(int row, int column, Gdiplus::Bitmap& bitmap, std::wstring& buffer) const;
+
+  private:
+    const Painter& painter;
+    Painter::Mapping map;
+    //one font size for all the tiles
+    GlyphAtlas glyphs;
+    int imageW;
+    int imageH;
+    int tile;
+    int rows;
+    int columns;
+    //indexed by layer
+    std::array<Bins, 3> bins;
+  };
+
+}